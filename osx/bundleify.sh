@@ -14,9 +14,6 @@ exe=$3
 
 mkdir -p "$bundle/Contents/lib"
 
-# Replace Control with Command in key bindings
-sed -i '' 's/GDK_CONTROL_MASK/GDK_META_MASK/' $bundle/Contents/patchage.ui
-
 # Copy font configuration files
 cp $prefix/etc/fonts/fonts.conf $bundle/Contents/Resources
 
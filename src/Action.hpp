@@ -5,11 +5,14 @@
 #define PATCHAGE_ACTION_HPP
 
 #include "ClientID.hpp"
+#include "Connection.hpp"
 #include "PortID.hpp"
 #include "Setting.hpp"
 #include "SignalDirection.hpp"
 
+#include <string>
 #include <variant>
+#include <vector>
 
 namespace patchage {
 namespace action {
@@ -18,6 +21,10 @@ struct ChangeSetting {
   Setting setting;
 };
 
+struct ConnectMany {
+  std::vector<Connection> connections;
+};
+
 struct ConnectPorts {
   PortID tail;
   PortID head;
@@ -30,6 +37,10 @@ struct DisconnectClient {
   SignalDirection direction;
 };
 
+struct DisconnectMany {
+  std::vector<Connection> connections;
+};
+
 struct DisconnectPort {
   PortID port;
 };
@@ -41,6 +52,10 @@ struct DisconnectPorts {
 
 struct IncreaseFontSize {};
 
+struct MonitorPort {
+  PortID port;
+};
+
 struct MoveModule {
   ClientID        client;
   SignalDirection direction;
@@ -52,10 +67,22 @@ struct Refresh {};
 
 struct ResetFontSize {};
 
+struct RestoreSnapshot {
+  std::string name;
+};
+
+struct SaveSnapshot {
+  std::string name;
+};
+
 struct SplitModule {
   ClientID client;
 };
 
+struct UnmonitorPort {
+  PortID port;
+};
+
 struct UnsplitModule {
   ClientID client;
 };
@@ -69,16 +96,22 @@ struct ZoomOut {};
 
 /// A high-level action from the user
 using Action = std::variant<action::ChangeSetting,
+                            action::ConnectMany,
                             action::ConnectPorts,
                             action::DecreaseFontSize,
                             action::DisconnectClient,
+                            action::DisconnectMany,
                             action::DisconnectPort,
                             action::DisconnectPorts,
                             action::IncreaseFontSize,
+                            action::MonitorPort,
                             action::MoveModule,
                             action::Refresh,
                             action::ResetFontSize,
+                            action::RestoreSnapshot,
+                            action::SaveSnapshot,
                             action::SplitModule,
+                            action::UnmonitorPort,
                             action::UnsplitModule,
                             action::ZoomFull,
                             action::ZoomIn,
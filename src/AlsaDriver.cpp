@@ -6,9 +6,11 @@
 #include "ClientID.hpp"
 #include "ClientInfo.hpp"
 #include "ClientType.hpp"
+#include "Connection.hpp"
 #include "Driver.hpp"
 #include "Event.hpp"
 #include "ILog.hpp"
+#include "PortActivity.hpp"
 #include "PortID.hpp"
 #include "PortInfo.hpp"
 #include "PortType.hpp"
@@ -20,26 +22,38 @@ PATCHAGE_DISABLE_FMT_WARNINGS
 PATCHAGE_RESTORE_WARNINGS
 
 #include <alsa/asoundlib.h>
-#include <pthread.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <cerrno>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <limits>
+#include <map>
 #include <memory>
 #include <optional>
-#include <set>
 #include <string>
+#include <thread>
 #include <utility>
 #include <variant>
+#include <vector>
 
 namespace patchage {
 namespace {
 
+/// Maximum number of ports that can be monitored at once
+constexpr size_t max_monitors = 64U;
+
 /// Driver for ALSA Sequencer ports
 class AlsaDriver : public Driver
 {
 public:
-  explicit AlsaDriver(ILog& log, EventSink emit_event);
+  explicit AlsaDriver(ILog& log, EventSink emit_events);
 
   AlsaDriver(const AlsaDriver&)            = delete;
   AlsaDriver& operator=(const AlsaDriver&) = delete;
@@ -56,34 +70,99 @@ public:
 
   void refresh(const EventSink& sink) override;
 
-  bool connect(const PortID& tail_id, const PortID& head_id) override;
+  std::vector<bool>
+  connect_many(const std::vector<Connection>& connections) override;
+
+  std::vector<bool>
+  disconnect_many(const std::vector<Connection>& connections) override;
+
+  bool monitor(const PortID& id) override;
+  void unmonitor(const PortID& id) override;
 
-  bool disconnect(const PortID& tail_id, const PortID& head_id) override;
+  std::optional<PortActivity> activity(const PortID& id) override;
 
 private:
-  bool         create_refresh_port();
-  static void* refresh_main(void* me);
-  void         _refresh_main();
-
-  ILog&      _log;
-  snd_seq_t* _seq{nullptr};
-  pthread_t  _refresh_thread{};
-
-  struct SeqAddrComparator {
-    bool operator()(const snd_seq_addr_t& a, const snd_seq_addr_t& b) const
-    {
-      return ((a.client < b.client) ||
-              ((a.client == b.client) && a.port < b.port));
-    }
+  /// A sender that the refresh port is subscribed to
+  struct Monitor {
+    std::atomic<int>      addr{-1}; ///< Client and port, or -1 if unused
+    std::atomic<uint32_t> n_events{0U};
+  };
+
+  bool create_refresh_port();
+  void refresh_main();
+  void count_event(const snd_seq_addr_t& source);
+  void clear_monitors();
+
+  std::vector<bool> subscribe_many(const std::vector<Connection>& connections,
+                                   bool                           subscribe);
+
+  void on_sequencer_event(const snd_seq_event_t* ev,
+                          snd_seq_client_info_t* cinfo,
+                          snd_seq_port_info_t*   pinfo,
+                          Events&                events);
+
+  ILog&       _log;
+  snd_seq_t*  _seq{nullptr};
+  int         _stop_fd{-1};
+  std::thread _refresh_thread;
+
+  std::atomic<int>                  _refresh_port{-1};
+  std::array<Monitor, max_monitors> _monitors;      ///< Used in refresh thread
+  std::map<PortID, size_t>          _monitor_slots; ///< Index into monitors
+
+  /// The cached state of a port address
+  enum class PortState : uint8_t {
+    unknown, ///< Not yet queried or since destroyed
+    ignored, ///< Hidden from the user
+    visible, ///< Shown to the user
   };
 
-  using Ignored = std::set<snd_seq_addr_t, SeqAddrComparator>;
+  /// A cached port info record
+  struct CachedPort {
+    PortState state;
+    unsigned  caps;
+    unsigned  type;
+  };
+
+  /**
+     Cache of port info records for every possible address.
+
+     This is accessed from both the GUI and refresh threads, so each record
+     is packed into a single atomic word.  Queries are idempotent, so if two
+     threads miss at once they simply store the same record.
+  */
+  using PortCache = std::unique_ptr<std::atomic<uint64_t>[]>;
+
+  /// Cache of client types, offset by one so that zero means unknown
+  using ClientTypeCache = std::array<std::atomic<int>, 256U>;
+
+  static uint64_t   pack_port(const CachedPort& port);
+  static CachedPort unpack_port(uint64_t entry);
+
+  std::atomic<uint64_t>& cache_entry(const snd_seq_addr_t& addr);
 
-  Ignored _ignored;
+  int        client_type(int client);
+  CachedPort cache_port(const snd_seq_port_info_t* pinfo, int client_type);
+  CachedPort port_record(const snd_seq_addr_t& addr, bool query = true);
+  void       forget_client(int client);
+  void       forget_port(const snd_seq_addr_t& addr);
 
-  bool ignore(const snd_seq_addr_t& addr, bool add = true);
+  void on_port_changed(const snd_seq_addr_t& addr,
+                       snd_seq_port_info_t*  pinfo,
+                       Events&               events);
+
+  bool ignore(const snd_seq_addr_t& addr, bool query = true);
+
+  PortCache       _port_cache;
+  ClientTypeCache _client_types{};
 };
 
+int
+pack_addr(const snd_seq_addr_t& addr)
+{
+  return (addr.client << 8) | addr.port;
+}
+
 PortID
 addr_to_id(const snd_seq_addr_t& addr, const bool is_input)
 {
@@ -128,9 +207,10 @@ port_info(const snd_seq_port_info_t* const pinfo)
           (type & SND_SEQ_PORT_TYPE_APPLICATION) == 0};
 }
 
-AlsaDriver::AlsaDriver(ILog& log, EventSink emit_event)
-  : Driver{std::move(emit_event)}
+AlsaDriver::AlsaDriver(ILog& log, EventSink emit_events)
+  : Driver{std::move(emit_events)}
   , _log(log)
+  , _port_cache{new std::atomic<uint64_t>[256U * 256U]()}
 {}
 
 AlsaDriver::~AlsaDriver() = default;
@@ -143,19 +223,18 @@ AlsaDriver::attach(bool /*launch_daemon*/)
     _log.error("[ALSA] Unable to attach");
     _seq = nullptr;
   } else {
-    _emit_event(event::DriverAttached{ClientType::alsa});
+    emit_event(event::DriverAttached{ClientType::alsa});
 
     snd_seq_set_client_name(_seq, "Patchage");
+    snd_seq_nonblock(_seq, 1);
 
-    pthread_attr_t attr;
-    pthread_attr_init(&attr);
-    pthread_attr_setstacksize(&attr, 50000);
-
-    ret =
-      pthread_create(&_refresh_thread, &attr, &AlsaDriver::refresh_main, this);
-    if (ret) {
-      _log.error("[ALSA] Failed to start refresh thread");
+    _stop_fd = eventfd(0U, EFD_CLOEXEC);
+    if (_stop_fd < 0) {
+      _log.error("[ALSA] Failed to create event descriptor");
+      return;
     }
+
+    _refresh_thread = std::thread{&AlsaDriver::refresh_main, this};
   }
 }
 
@@ -163,11 +242,26 @@ void
 AlsaDriver::detach()
 {
   if (_seq) {
-    pthread_cancel(_refresh_thread);
-    pthread_join(_refresh_thread, nullptr);
+    if (_refresh_thread.joinable()) {
+      const uint64_t stop = 1U;
+      if (write(_stop_fd, &stop, sizeof(stop)) == sizeof(stop)) {
+        _refresh_thread.join();
+      } else {
+        _log.error("[ALSA] Failed to stop refresh thread");
+        _refresh_thread.detach();
+      }
+    }
+
+    if (_stop_fd >= 0) {
+      close(_stop_fd);
+      _stop_fd = -1;
+    }
+
     snd_seq_close(_seq);
     _seq = nullptr;
-    _emit_event(event::DriverDetached{ClientType::alsa});
+    _refresh_port.store(-1);
+    clear_monitors();
+    emit_event(event::DriverDetached{ClientType::alsa});
   }
 }
 
@@ -178,217 +272,423 @@ AlsaDriver::refresh(const EventSink& sink)
     return;
   }
 
-  _ignored.clear();
+  /// Everything in the sequencer, gathered in a single pass
+  struct Snapshot {
+    std::vector<event::ClientCreated>                      clients;
+    std::vector<event::PortCreated>                        ports;
+    std::vector<std::pair<snd_seq_addr_t, snd_seq_addr_t>> connections;
+  };
 
   snd_seq_client_info_t* cinfo = nullptr;
   snd_seq_client_info_alloca(&cinfo);
-  snd_seq_client_info_set_client(cinfo, -1);
 
   snd_seq_port_info_t* pinfo = nullptr;
   snd_seq_port_info_alloca(&pinfo);
 
-  // Emit all clients
+  snd_seq_query_subscribe_t* sinfo = nullptr;
+  snd_seq_query_subscribe_alloca(&sinfo);
+  snd_seq_query_subscribe_set_type(sinfo, SND_SEQ_QUERY_SUBS_READ);
+
+  // Gather all clients, ports, and connections, updating the cache
+  Snapshot snapshot;
   snd_seq_client_info_set_client(cinfo, -1);
   while (snd_seq_query_next_client(_seq, cinfo) >= 0) {
     const auto client_id = snd_seq_client_info_get_client(cinfo);
+    const auto type      = snd_seq_client_info_get_type(cinfo);
 
     assert(client_id < std::numeric_limits<uint8_t>::max());
-    sink({event::ClientCreated{ClientID::alsa(static_cast<uint8_t>(client_id)),
-                               client_info(cinfo)}});
-  }
+    snapshot.clients.push_back(
+      {ClientID::alsa(static_cast<uint8_t>(client_id)), client_info(cinfo)});
 
-  // Emit all ports
-  snd_seq_client_info_set_client(cinfo, -1);
-  while (snd_seq_query_next_client(_seq, cinfo) >= 0) {
-    const auto client_id = snd_seq_client_info_get_client(cinfo);
+    _client_types[static_cast<uint8_t>(client_id)].store(
+      type + 1, std::memory_order_release);
 
     snd_seq_port_info_set_client(pinfo, client_id);
     snd_seq_port_info_set_port(pinfo, -1);
     while (snd_seq_query_next_port(_seq, pinfo) >= 0) {
-      const auto addr = *snd_seq_port_info_get_addr(pinfo);
-      if (!ignore(addr)) {
-        const auto caps = snd_seq_port_info_get_capability(pinfo);
-        auto       info = port_info(pinfo);
-
-        if (caps & SND_SEQ_PORT_CAP_READ) {
-          info.direction = SignalDirection::output;
-          sink({event::PortCreated{addr_to_id(addr, false), info}});
-        }
-
-        if (caps & SND_SEQ_PORT_CAP_WRITE) {
-          info.direction = SignalDirection::input;
-          sink({event::PortCreated{addr_to_id(addr, true), info}});
-        }
+      const auto       addr = *snd_seq_port_info_get_addr(pinfo);
+      const CachedPort port = cache_port(pinfo, type);
+      if (port.state != PortState::visible) {
+        continue;
       }
-    }
-  }
 
-  // Emit all connections
-  snd_seq_client_info_set_client(cinfo, -1);
-  while (snd_seq_query_next_client(_seq, cinfo) >= 0) {
-    const auto client_id = snd_seq_client_info_get_client(cinfo);
-
-    snd_seq_port_info_set_client(pinfo, client_id);
-    snd_seq_port_info_set_port(pinfo, -1);
-    while (snd_seq_query_next_port(_seq, pinfo) >= 0) {
-      const auto port_addr = *snd_seq_port_info_get_addr(pinfo);
-      const auto caps      = snd_seq_port_info_get_capability(pinfo);
-
-      if (!ignore(port_addr) && (caps & SND_SEQ_PORT_CAP_READ)) {
-        const auto tail_id = addr_to_id(port_addr, false);
+      auto info = port_info(pinfo);
+      if (port.caps & SND_SEQ_PORT_CAP_READ) {
+        info.direction = SignalDirection::output;
+        snapshot.ports.push_back({addr_to_id(addr, false), info});
 
-        snd_seq_query_subscribe_t* sinfo = nullptr;
-        snd_seq_query_subscribe_alloca(&sinfo);
-        snd_seq_query_subscribe_set_type(sinfo, SND_SEQ_QUERY_SUBS_READ);
-        snd_seq_query_subscribe_set_root(sinfo, &port_addr);
+        snd_seq_query_subscribe_set_root(sinfo, &addr);
         snd_seq_query_subscribe_set_index(sinfo, 0);
         while (!snd_seq_query_port_subscribers(_seq, sinfo)) {
-          const auto head_addr = *snd_seq_query_subscribe_get_addr(sinfo);
-          const auto head_id   = addr_to_id(head_addr, true);
-
-          sink({event::PortsConnected{tail_id, head_id}});
+          snapshot.connections.emplace_back(
+            addr, *snd_seq_query_subscribe_get_addr(sinfo));
 
           snd_seq_query_subscribe_set_index(
             sinfo, snd_seq_query_subscribe_get_index(sinfo) + 1);
         }
       }
+
+      if (port.caps & SND_SEQ_PORT_CAP_WRITE) {
+        info.direction = SignalDirection::input;
+        snapshot.ports.push_back({addr_to_id(addr, true), info});
+      }
+    }
+  }
+
+  // Emit all clients, then all ports, then all connections between them
+  Events events;
+  events.reserve(snapshot.clients.size() + snapshot.ports.size() +
+                 snapshot.connections.size());
+
+  for (auto& client : snapshot.clients) {
+    events.emplace_back(std::move(client));
+  }
+
+  for (auto& port : snapshot.ports) {
+    events.emplace_back(std::move(port));
+  }
+
+  for (const auto& connection : snapshot.connections) {
+    if (!ignore(connection.second)) {
+      events.emplace_back(
+        event::PortsConnected{addr_to_id(connection.first, false),
+                              addr_to_id(connection.second, true)});
     }
   }
+
+  sink(std::move(events));
 }
 
-bool
-AlsaDriver::ignore(const snd_seq_addr_t& addr, bool add)
+uint64_t
+AlsaDriver::pack_port(const CachedPort& port)
 {
-  if (_ignored.find(addr) != _ignored.end()) {
-    return true;
-  }
+  return static_cast<uint64_t>(port.state) |
+         (static_cast<uint64_t>(port.caps & 0xFFFFFFU) << 8U) |
+         (static_cast<uint64_t>(port.type) << 32U);
+}
 
-  if (!add) {
-    return false;
+AlsaDriver::CachedPort
+AlsaDriver::unpack_port(const uint64_t entry)
+{
+  return {static_cast<PortState>(entry & 0xFFU),
+          static_cast<unsigned>((entry >> 8U) & 0xFFFFFFU),
+          static_cast<unsigned>(entry >> 32U)};
+}
+
+std::atomic<uint64_t>&
+AlsaDriver::cache_entry(const snd_seq_addr_t& addr)
+{
+  return _port_cache[(addr.client * 256U) + addr.port];
+}
+
+int
+AlsaDriver::client_type(const int client)
+{
+  auto&     entry  = _client_types[static_cast<uint8_t>(client)];
+  const int cached = entry.load(std::memory_order_acquire);
+  if (cached) {
+    return cached - 1;
   }
 
   snd_seq_client_info_t* cinfo = nullptr;
   snd_seq_client_info_alloca(&cinfo);
-  snd_seq_client_info_set_client(cinfo, addr.client);
-  snd_seq_get_any_client_info(_seq, addr.client, cinfo);
+  if (snd_seq_get_any_client_info(_seq, client, cinfo)) {
+    return -1;
+  }
 
-  snd_seq_port_info_t* pinfo = nullptr;
-  snd_seq_port_info_alloca(&pinfo);
-  snd_seq_port_info_set_client(pinfo, addr.client);
-  snd_seq_port_info_set_port(pinfo, addr.port);
-  snd_seq_get_any_port_info(_seq, addr.client, addr.port, pinfo);
+  const int type = snd_seq_client_info_get_type(cinfo);
+  entry.store(type + 1, std::memory_order_release);
+  return type;
+}
 
+AlsaDriver::CachedPort
+AlsaDriver::cache_port(const snd_seq_port_info_t* const pinfo,
+                       const int                        client_type)
+{
   const unsigned type = snd_seq_port_info_get_type(pinfo);
   const unsigned caps = snd_seq_port_info_get_capability(pinfo);
 
-  if (caps & SND_SEQ_PORT_CAP_NO_EXPORT) {
-    _ignored.insert(addr);
-    return true;
+  PortState state = PortState::visible;
+  if ((caps & SND_SEQ_PORT_CAP_NO_EXPORT) ||
+      !((caps & SND_SEQ_PORT_CAP_READ) || (caps & SND_SEQ_PORT_CAP_WRITE) ||
+        (caps & SND_SEQ_PORT_CAP_DUPLEX)) ||
+      ((client_type != SND_SEQ_USER_CLIENT) &&
+       ((type == SND_SEQ_PORT_SYSTEM_TIMER ||
+         type == SND_SEQ_PORT_SYSTEM_ANNOUNCE)))) {
+    state = PortState::ignored;
   }
 
-  if (!((caps & SND_SEQ_PORT_CAP_READ) || (caps & SND_SEQ_PORT_CAP_WRITE) ||
-        (caps & SND_SEQ_PORT_CAP_DUPLEX))) {
-    _ignored.insert(addr);
-    return true;
+  const CachedPort port{state, caps, type};
+  cache_entry(*snd_seq_port_info_get_addr(pinfo))
+    .store(pack_port(port), std::memory_order_release);
+
+  return port;
+}
+
+AlsaDriver::CachedPort
+AlsaDriver::port_record(const snd_seq_addr_t& addr, const bool query)
+{
+  const CachedPort cached =
+    unpack_port(cache_entry(addr).load(std::memory_order_acquire));
+  if (cached.state != PortState::unknown || !query) {
+    return cached;
   }
 
-  if ((snd_seq_client_info_get_type(cinfo) != SND_SEQ_USER_CLIENT) &&
-      ((type == SND_SEQ_PORT_SYSTEM_TIMER ||
-        type == SND_SEQ_PORT_SYSTEM_ANNOUNCE))) {
-    _ignored.insert(addr);
-    return true;
+  const int type = client_type(addr.client);
+
+  snd_seq_port_info_t* pinfo = nullptr;
+  snd_seq_port_info_alloca(&pinfo);
+  if (type < 0 ||
+      snd_seq_get_any_port_info(_seq, addr.client, addr.port, pinfo)) {
+    return cached; // Port is already gone, don't cache anything
   }
 
-  return false;
+  return cache_port(pinfo, type);
 }
 
-bool
-AlsaDriver::connect(const PortID& tail_id, const PortID& head_id)
+void
+AlsaDriver::forget_client(const int client)
 {
-  if (tail_id.type() != PortID::Type::alsa ||
-      head_id.type() != PortID::Type::alsa) {
-    _log.error("[ALSA] Attempt to connect non-ALSA ports");
-    return false;
+  _client_types[static_cast<uint8_t>(client)].store(0,
+                                                    std::memory_order_release);
+
+  for (unsigned port = 0U; port < 256U; ++port) {
+    _port_cache[(static_cast<uint8_t>(client) * 256U) + port].store(
+      0U, std::memory_order_release);
   }
+}
 
-  const snd_seq_addr_t tail_addr = {tail_id.alsa_client(), tail_id.alsa_port()};
-  const snd_seq_addr_t head_addr = {head_id.alsa_client(), head_id.alsa_port()};
+void
+AlsaDriver::forget_port(const snd_seq_addr_t& addr)
+{
+  cache_entry(addr).store(0U, std::memory_order_release);
+}
 
-  if (tail_addr.client == head_addr.client &&
-      tail_addr.port == head_addr.port) {
-    _log.warning("[ALSA] Refusing to connect port to itself");
-    return false;
+void
+AlsaDriver::on_port_changed(const snd_seq_addr_t&       addr,
+                            snd_seq_port_info_t* const pinfo,
+                            Events&                    events)
+{
+  const CachedPort old_port = port_record(addr, false);
+
+  const int type = client_type(addr.client);
+  if (type < 0 ||
+      snd_seq_get_any_port_info(_seq, addr.client, addr.port, pinfo)) {
+    return; // Port is already gone
   }
 
-  bool result = true;
+  const CachedPort new_port = cache_port(pinfo, type);
+
+  const bool     was_known = old_port.state != PortState::unknown;
+  const unsigned old_caps =
+    (old_port.state == PortState::visible) ? old_port.caps : 0U;
+  const unsigned new_caps =
+    (new_port.state == PortState::visible) ? new_port.caps : 0U;
+
+  // Update each side in place, re-creating only those that appear or vanish
+  auto info = port_info(pinfo);
+  for (const bool is_input : {false, true}) {
+    const auto     id = addr_to_id(addr, is_input);
+    const unsigned cap =
+      is_input ? SND_SEQ_PORT_CAP_WRITE : SND_SEQ_PORT_CAP_READ;
+
+    info.direction =
+      is_input ? SignalDirection::input : SignalDirection::output;
+
+    if (new_caps & cap) {
+      if (was_known && !(old_caps & cap)) {
+        events.emplace_back(event::PortCreated{id, info});
+      } else {
+        events.emplace_back(event::PortChanged{id, info});
+      }
+    } else if ((old_caps & cap) || !was_known) {
+      events.emplace_back(event::PortDestroyed{id});
+    }
+  }
+}
 
+bool
+AlsaDriver::ignore(const snd_seq_addr_t& addr, const bool query)
+{
+  return port_record(addr, query).state == PortState::ignored;
+}
+
+std::vector<bool>
+AlsaDriver::connect_many(const std::vector<Connection>& connections)
+{
+  return subscribe_many(connections, true);
+}
+
+std::vector<bool>
+AlsaDriver::disconnect_many(const std::vector<Connection>& connections)
+{
+  return subscribe_many(connections, false);
+}
+
+std::vector<bool>
+AlsaDriver::subscribe_many(const std::vector<Connection>& connections,
+                           const bool                     subscribe)
+{
+  std::vector<bool> results(connections.size(), false);
+  if (!_seq) {
+    return results;
+  }
+
+  // Reuse a single subscription for every connection in the batch
   snd_seq_port_subscribe_t* subs = nullptr;
-  snd_seq_port_subscribe_malloc(&subs);
-  snd_seq_port_subscribe_set_sender(subs, &tail_addr);
-  snd_seq_port_subscribe_set_dest(subs, &head_addr);
+  snd_seq_port_subscribe_alloca(&subs);
   snd_seq_port_subscribe_set_exclusive(subs, 0);
   snd_seq_port_subscribe_set_time_update(subs, 0);
   snd_seq_port_subscribe_set_time_real(subs, 0);
 
-  // Already connected (shouldn't happen)
-  if (!snd_seq_get_port_subscription(_seq, subs)) {
-    _log.error("[ALSA] Attempt to double subscribe ports");
-    result = false;
-  }
+  std::string error;
+  for (size_t i = 0U; i < connections.size(); ++i) {
+    const PortID& tail_id = connections[i].tail;
+    const PortID& head_id = connections[i].head;
+    const char*   failure = nullptr;
+
+    if (tail_id.type() != PortID::Type::alsa ||
+        head_id.type() != PortID::Type::alsa) {
+      failure = "not ALSA ports";
+    } else {
+      const snd_seq_addr_t tail = {tail_id.alsa_client(), tail_id.alsa_port()};
+      const snd_seq_addr_t head = {head_id.alsa_client(), head_id.alsa_port()};
+
+      snd_seq_port_subscribe_set_sender(subs, &tail);
+      snd_seq_port_subscribe_set_dest(subs, &head);
+
+      if (tail.client == head.client && tail.port == head.port) {
+        failure = "port connected to itself";
+      } else if (subscribe == !snd_seq_get_port_subscription(_seq, subs)) {
+        failure = subscribe ? "already connected" : "not connected";
+      } else {
+        const int ret = subscribe ? snd_seq_subscribe_port(_seq, subs)
+                                  : snd_seq_unsubscribe_port(_seq, subs);
+
+        failure = (ret < 0) ? snd_strerror(ret) : nullptr;
+      }
+    }
 
-  const int ret = snd_seq_subscribe_port(_seq, subs);
-  if (ret < 0) {
-    _log.error(
-      fmt::format("[ALSA] Subscription failed ({})", snd_strerror(ret)));
-    result = false;
+    results[i] = !failure;
+    if (failure && error.empty()) {
+      error = failure;
+    }
   }
 
-  if (!result) {
-    _log.error(
-      fmt::format("[ALSA] Failed to connect {} => {}", tail_id, head_id));
+  if (!error.empty()) {
+    _log.error(failure_message(subscribe ? "[ALSA] Failed to connect"
+                                         : "[ALSA] Failed to disconnect",
+                               connections,
+                               results,
+                               error));
   }
 
-  return (!result);
+  return results;
 }
 
 bool
-AlsaDriver::disconnect(const PortID& tail_id, const PortID& head_id)
+AlsaDriver::monitor(const PortID& id)
 {
-  if (tail_id.type() != PortID::Type::alsa ||
-      head_id.type() != PortID::Type::alsa) {
-    _log.error("[ALSA] Attempt to disconnect non-ALSA ports");
+  if (id.type() != PortID::Type::alsa || id.alsa_is_input()) {
+    _log.warning(
+      fmt::format("[ALSA] Only outputs can be monitored, not {}", id));
     return false;
   }
 
-  const snd_seq_addr_t tail_addr = {tail_id.alsa_client(), tail_id.alsa_port()};
-  const snd_seq_addr_t head_addr = {head_id.alsa_client(), head_id.alsa_port()};
+  if (_monitor_slots.count(id)) {
+    return true; // Already monitored
+  }
 
-  snd_seq_port_subscribe_t* subs = nullptr;
-  snd_seq_port_subscribe_malloc(&subs);
-  snd_seq_port_subscribe_set_sender(subs, &tail_addr);
-  snd_seq_port_subscribe_set_dest(subs, &head_addr);
-  snd_seq_port_subscribe_set_exclusive(subs, 0);
-  snd_seq_port_subscribe_set_time_update(subs, 0);
-  snd_seq_port_subscribe_set_time_real(subs, 0);
+  const int refresh_port = _refresh_port.load();
+  if (!_seq || refresh_port < 0) {
+    return false;
+  }
+
+  // Find a free slot for the monitor
+  size_t slot = 0U;
+  while (slot < max_monitors && _monitors[slot].addr.load() >= 0) {
+    ++slot;
+  }
 
-  // Not connected (shouldn't happen)
-  if (snd_seq_get_port_subscription(_seq, subs) != 0) {
-    _log.error("[ALSA] Attempt to unsubscribe ports that are not subscribed");
+  if (slot == max_monitors) {
+    _log.warning(fmt::format(
+      "[ALSA] Unable to monitor more than {} ports at once", max_monitors));
     return false;
   }
 
-  const int ret = snd_seq_unsubscribe_port(_seq, subs);
-  if (ret < 0) {
-    _log.error(fmt::format("[ALSA] Failed to disconnect {} => {} ({})",
-                           tail_id,
-                           head_id,
-                           snd_strerror(ret)));
+  // Publish the address to the refresh thread before events can arrive
+  const snd_seq_addr_t addr = {id.alsa_client(), id.alsa_port()};
+  _monitors[slot].n_events.store(0U);
+  _monitors[slot].addr.store(pack_addr(addr));
+
+  // Subscribe our listen port to the sender
+  const int ret =
+    snd_seq_connect_from(_seq, refresh_port, addr.client, addr.port);
+  if (ret) {
+    _log.error(fmt::format(
+      "[ALSA] Failed to subscribe to {} ({})", id, snd_strerror(ret)));
+    _monitors[slot].addr.store(-1);
     return false;
   }
 
+  _monitor_slots.emplace(id, slot);
   return true;
 }
 
+void
+AlsaDriver::unmonitor(const PortID& id)
+{
+  const auto s = _monitor_slots.find(id);
+  if (s == _monitor_slots.end()) {
+    return;
+  }
+
+  const int refresh_port = _refresh_port.load();
+  if (_seq && refresh_port >= 0) {
+    snd_seq_disconnect_from(
+      _seq, refresh_port, id.alsa_client(), id.alsa_port());
+  }
+
+  _monitors[s->second].addr.store(-1);
+  _monitor_slots.erase(s);
+}
+
+std::optional<PortActivity>
+AlsaDriver::activity(const PortID& id)
+{
+  const auto s = _monitor_slots.find(id);
+  if (s == _monitor_slots.end()) {
+    return {};
+  }
+
+  const uint32_t n_events =
+    _monitors[s->second].n_events.exchange(0U, std::memory_order_relaxed);
+
+  return PortActivity{0.0f, 0.0f, n_events};
+}
+
+void
+AlsaDriver::count_event(const snd_seq_addr_t& source)
+{
+  const int addr = pack_addr(source);
+  for (auto& monitor : _monitors) {
+    if (monitor.addr.load(std::memory_order_relaxed) == addr) {
+      monitor.n_events.fetch_add(1U, std::memory_order_relaxed);
+      return;
+    }
+  }
+}
+
+void
+AlsaDriver::clear_monitors()
+{
+  for (auto& monitor : _monitors) {
+    monitor.addr.store(-1);
+  }
+
+  _monitor_slots.clear();
+}
+
 bool
 AlsaDriver::create_refresh_port()
 {
@@ -408,6 +708,8 @@ AlsaDriver::create_refresh_port()
     return false;
   }
 
+  _refresh_port.store(snd_seq_port_info_get_port(info));
+
   // Subscribe the port to the system announcer
   ret = snd_seq_connect_from(_seq,
                              snd_seq_port_info_get_port(info),
@@ -423,107 +725,179 @@ AlsaDriver::create_refresh_port()
   return true;
 }
 
-void*
-AlsaDriver::refresh_main(void* me)
-{
-  auto* ad = static_cast<AlsaDriver*>(me);
-  ad->_refresh_main();
-  return nullptr;
-}
-
 void
-AlsaDriver::_refresh_main()
+AlsaDriver::refresh_main()
 {
   if (!create_refresh_port()) {
     _log.error("[ALSA] Could not create listen port, auto-refresh disabled");
     return;
   }
 
-  unsigned caps = 0U;
-
   snd_seq_client_info_t* cinfo = nullptr;
   snd_seq_client_info_alloca(&cinfo);
 
   snd_seq_port_info_t* pinfo = nullptr;
   snd_seq_port_info_alloca(&pinfo);
 
-  snd_seq_event_t* ev = nullptr;
-  while (snd_seq_event_input(_seq, &ev) > 0) {
-    assert(ev);
+  // Wait for events from the sequencer, or for detach() to stop the thread
+  const auto n_seq_fds = snd_seq_poll_descriptors_count(_seq, POLLIN);
+  if (n_seq_fds <= 0) {
+    _log.error("[ALSA] Failed to get poll descriptors, auto-refresh disabled");
+    return;
+  }
+
+  std::vector<pollfd> fds(static_cast<size_t>(n_seq_fds) + 1U);
+  snd_seq_poll_descriptors(
+    _seq, fds.data(), static_cast<unsigned>(n_seq_fds), POLLIN);
+  fds.back() = {_stop_fd, POLLIN, 0};
+
+  while (true) {
+    if (poll(fds.data(), fds.size(), -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      _log.error(fmt::format("[ALSA] Poll failed ({})", strerror(errno)));
+      return;
+    }
+
+    if (fds.back().revents) {
+      return; // Stopped by detach()
+    }
 
-    switch (ev->type) {
-    case SND_SEQ_EVENT_CLIENT_START:
-      snd_seq_get_any_client_info(_seq, ev->data.addr.client, cinfo);
-      _emit_event(event::ClientCreated{
+    // Handle every event that has arrived without blocking
+    Events events;
+    while (snd_seq_event_input_pending(_seq, 1) > 0) {
+      snd_seq_event_t* ev = nullptr;
+      if (snd_seq_event_input(_seq, &ev) >= 0 && ev) {
+        on_sequencer_event(ev, cinfo, pinfo, events);
+      }
+    }
+
+    // Emit the resulting changes as a single batch
+    if (!events.empty()) {
+      _emit_events(std::move(events));
+    }
+  }
+}
+
+void
+AlsaDriver::on_sequencer_event(const snd_seq_event_t* const ev,
+                               snd_seq_client_info_t* const cinfo,
+                               snd_seq_port_info_t* const   pinfo,
+                               Events&                      events)
+{
+  // Count events from monitored senders, everything else is an announcement
+  if (ev->source.client != SND_SEQ_CLIENT_SYSTEM) {
+    count_event(ev->source);
+    return;
+  }
+
+  switch (ev->type) {
+  case SND_SEQ_EVENT_CLIENT_START:
+    forget_client(ev->data.addr.client);
+    snd_seq_get_any_client_info(_seq, ev->data.addr.client, cinfo);
+    events.emplace_back(event::ClientCreated{
+      ClientID::alsa(ev->data.addr.client),
+      client_info(cinfo),
+    });
+    break;
+
+  case SND_SEQ_EVENT_CLIENT_EXIT:
+    events.emplace_back(event::ClientDestroyed{
+      ClientID::alsa(ev->data.addr.client),
+    });
+    forget_client(ev->data.addr.client);
+    break;
+
+  case SND_SEQ_EVENT_CLIENT_CHANGE:
+    if (!snd_seq_get_any_client_info(_seq, ev->data.addr.client, cinfo)) {
+      _client_types[ev->data.addr.client].store(
+        snd_seq_client_info_get_type(cinfo) + 1, std::memory_order_release);
+
+      events.emplace_back(event::ClientChanged{
         ClientID::alsa(ev->data.addr.client),
         client_info(cinfo),
       });
-      break;
+    }
+    break;
+
+  case SND_SEQ_EVENT_PORT_START: {
+    const int type = client_type(ev->data.addr.client);
+    if (type < 0 || snd_seq_get_any_port_info(_seq,
+                                              ev->data.addr.client,
+                                              ev->data.addr.port,
+                                              pinfo)) {
+      break; // Port is already gone
+    }
 
-    case SND_SEQ_EVENT_CLIENT_EXIT:
-      _emit_event(event::ClientDestroyed{
-        ClientID::alsa(ev->data.addr.client),
+    const CachedPort port = cache_port(pinfo, type);
+    if (port.state == PortState::visible) {
+      events.emplace_back(event::PortCreated{
+        addr_to_id(ev->data.addr, (port.caps & SND_SEQ_PORT_CAP_WRITE)),
+        port_info(pinfo),
       });
-      break;
-
-    case SND_SEQ_EVENT_CLIENT_CHANGE:
-      break;
-
-    case SND_SEQ_EVENT_PORT_START:
-      snd_seq_get_any_client_info(_seq, ev->data.addr.client, cinfo);
-      snd_seq_get_any_port_info(
-        _seq, ev->data.addr.client, ev->data.addr.port, pinfo);
-      caps = snd_seq_port_info_get_capability(pinfo);
-
-      if (!ignore(ev->data.addr)) {
-        _emit_event(event::PortCreated{
-          addr_to_id(ev->data.addr, (caps & SND_SEQ_PORT_CAP_WRITE)),
-          port_info(pinfo),
-        });
+    }
+    break;
+  }
+
+  case SND_SEQ_EVENT_PORT_EXIT: {
+    // Getting caps at this point does not work, so use the cached ones
+    const CachedPort port = port_record(ev->data.addr, false);
+    if (port.state == PortState::visible) {
+      if (port.caps & SND_SEQ_PORT_CAP_WRITE) {
+        events.emplace_back(
+          event::PortDestroyed{addr_to_id(ev->data.addr, true)});
       }
-      break;
-
-    case SND_SEQ_EVENT_PORT_EXIT:
-      if (!ignore(ev->data.addr, false)) {
-        // Note: getting caps at this point does not work
-        // Delete both inputs and outputs (to handle duplex ports)
-        _emit_event(event::PortDestroyed{addr_to_id(ev->data.addr, true)});
-        _emit_event(event::PortDestroyed{addr_to_id(ev->data.addr, false)});
+
+      if (port.caps & SND_SEQ_PORT_CAP_READ) {
+        events.emplace_back(
+          event::PortDestroyed{addr_to_id(ev->data.addr, false)});
       }
-      break;
+    } else if (port.state == PortState::unknown) {
+      // Delete both inputs and outputs (to handle duplex ports)
+      events.emplace_back(
+        event::PortDestroyed{addr_to_id(ev->data.addr, true)});
+      events.emplace_back(
+        event::PortDestroyed{addr_to_id(ev->data.addr, false)});
+    }
 
-    case SND_SEQ_EVENT_PORT_CHANGE:
-      break;
+    forget_port(ev->data.addr);
+    break;
+  }
 
-    case SND_SEQ_EVENT_PORT_SUBSCRIBED:
-      if (!ignore(ev->data.connect.sender) && !ignore(ev->data.connect.dest)) {
-        _emit_event(
-          event::PortsConnected{addr_to_id(ev->data.connect.sender, false),
-                                addr_to_id(ev->data.connect.dest, true)});
-      }
-      break;
+  case SND_SEQ_EVENT_PORT_CHANGE:
+    on_port_changed(ev->data.addr, pinfo, events);
+    break;
 
-    case SND_SEQ_EVENT_PORT_UNSUBSCRIBED:
-      if (!ignore(ev->data.connect.sender) && !ignore(ev->data.connect.dest)) {
-        _emit_event(
-          event::PortsDisconnected{addr_to_id(ev->data.connect.sender, false),
-                                   addr_to_id(ev->data.connect.dest, true)});
-      }
-      break;
+  case SND_SEQ_EVENT_PORT_SUBSCRIBED:
+    if (!ignore(ev->data.connect.sender) && !ignore(ev->data.connect.dest)) {
+      events.emplace_back(
+        event::PortsConnected{addr_to_id(ev->data.connect.sender, false),
+                              addr_to_id(ev->data.connect.dest, true)});
+    }
+    break;
 
-    case SND_SEQ_EVENT_RESET:
-    default:
-      break;
+  case SND_SEQ_EVENT_PORT_UNSUBSCRIBED:
+    if (!ignore(ev->data.connect.sender) && !ignore(ev->data.connect.dest)) {
+      events.emplace_back(
+        event::PortsDisconnected{addr_to_id(ev->data.connect.sender, false),
+                                 addr_to_id(ev->data.connect.dest, true)});
     }
+    break;
+
+  case SND_SEQ_EVENT_RESET:
+  default:
+    break;
   }
 }
 
 } // namespace
 
 std::unique_ptr<Driver>
-make_alsa_driver(ILog& log, Driver::EventSink emit_event)
+make_alsa_driver(ILog& log, Driver::EventSink emit_events)
 {
-  return std::unique_ptr<Driver>{new AlsaDriver{log, std::move(emit_event)}};
+  return std::unique_ptr<Driver>{new AlsaDriver{log, std::move(emit_events)}};
 }
 
 } // namespace patchage
@@ -11,12 +11,17 @@
 
 namespace patchage {
 
-/// Base class for drivers that work with an audio system
+/**
+   Base class for drivers that work with an audio system.
+
+   These methods are called regularly from the GUI thread, so they must not
+   block.  They may return the last known value and update it asynchronously.
+*/
 class AudioDriver : public Driver
 {
 public:
-  explicit AudioDriver(EventSink emit_event)
-    : Driver{std::move(emit_event)}
+  explicit AudioDriver(EventSink emit_events)
+    : Driver{std::move(emit_events)}
   {}
 
   /// Return the number of xruns (dropouts) since the last reset
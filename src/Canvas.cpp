@@ -11,6 +11,7 @@
 #include "ClientInfo.hpp"
 #include "ClientType.hpp"
 #include "Configuration.hpp"
+#include "Connection.hpp"
 #include "Coord.hpp"
 #include "ILog.hpp"
 #include "Metadata.hpp"
@@ -36,19 +37,42 @@ PATCHAGE_DISABLE_FMT_WARNINGS
 PATCHAGE_RESTORE_WARNINGS
 
 #include <gdk/gdkkeysyms.h>
+#include <glib-object.h>
+#include <glib.h>
 #include <sigc++/functors/mem_fun.h>
 #include <sigc++/signal.h>
 
 #include <cassert>
+#include <chrono>
 #include <optional>
 #include <set>
 #include <string>
 #include <utility>
 #include <variant>
+#include <vector>
 
 namespace patchage {
 namespace {
 
+/// Time to wait for the system to confirm a change made by the user
+constexpr auto change_timeout = std::chrono::seconds{5};
+
+/// Set whether an edge is drawn as a connection that is not yet confirmed
+void
+set_pending(Ganv::Edge& edge, const bool pending)
+{
+  g_object_set(G_OBJECT(edge.gobj()), "ghost", pending ? TRUE : FALSE, nullptr);
+}
+
+/// Set whether a port is drawn as one that may no longer exist
+void
+set_stale(Ganv::Port& port, const bool stale)
+{
+  const double dash_length = stale ? 2.0 : 0.0;
+
+  g_object_set(G_OBJECT(port.gobj()), "dash-length", dash_length, nullptr);
+}
+
 struct RemovePortsData {
   using Predicate = bool (*)(const CanvasPort*);
 
@@ -70,6 +94,41 @@ delete_port_if_matches(GanvPort* port, void* cdata)
   }
 }
 
+/// Return the connection between two ports in either order, if any
+std::optional<Connection>
+edge_connection(Ganv::Node* port1, Ganv::Node* port2)
+{
+  auto* const p1 = dynamic_cast<CanvasPort*>(port1);
+  auto* const p2 = dynamic_cast<CanvasPort*>(port2);
+
+  if (p1 && p2) {
+    if (p1->is_output() && p2->is_input()) {
+      return Connection{p1->id(), p2->id()};
+    }
+
+    if (p2->is_output() && p1->is_input()) {
+      return Connection{p2->id(), p1->id()};
+    }
+  }
+
+  return std::nullopt;
+}
+
+/// Append the connection of an edge to a vector of connections
+void
+collect_edge(GanvEdge* edge, void* data)
+{
+  auto*       connections = static_cast<std::vector<Connection>*>(data);
+  Ganv::Edge* edgemm      = Glib::wrap(edge);
+
+  if (edgemm) {
+    const auto c = edge_connection(edgemm->get_tail(), edgemm->get_head());
+    if (c) {
+      connections->push_back(*c);
+    }
+  }
+}
+
 void
 remove_ports_matching(GanvNode* node, void* cdata)
 {
@@ -111,6 +170,18 @@ Canvas::create_port(Configuration&  conf,
                     const PortID&   id,
                     const PortInfo& info)
 {
+  // Reuse a port shown from the cache if it hasn't changed kind
+  if (_stale_ports.erase(id)) {
+    CanvasPort* const stale = find_port(id);
+    if (stale && stale->type() == info.type &&
+        stale->is_input() == (info.direction == SignalDirection::input)) {
+      set_stale(*stale, false);
+      return update_port(conf, metadata, id, info);
+    }
+
+    remove_port(id);
+  }
+
   const auto client_id = id.client();
 
   const auto port_name =
@@ -165,6 +236,7 @@ Canvas::create_port(Configuration&  conf,
   }
 
   auto* const port = new CanvasPort(*parent,
+                                    _action_sink,
                                     info.type,
                                     id,
                                     port_name,
@@ -176,6 +248,28 @@ Canvas::create_port(Configuration&  conf,
 
   _port_index.insert(std::make_pair(id, port));
 
+  if (_monitored_ports.count(id)) {
+    port->set_monitored(true);
+  }
+
+  return port;
+}
+
+CanvasPort*
+Canvas::update_port(Configuration&  conf,
+                    const Metadata& metadata,
+                    const PortID&   id,
+                    const PortInfo& info)
+{
+  CanvasPort* const port = find_port(id);
+  if (!port) {
+    return create_port(conf, metadata, id, info);
+  }
+
+  const auto port_name =
+    ((id.type() == PortID::Type::alsa) ? info.label : PortNames(id).port());
+
+  port->set_names(port_name, info.label, conf.get<setting::HumanNames>());
   return port;
 }
 
@@ -209,6 +303,78 @@ Canvas::remove_module(const ClientID& id)
   }
 }
 
+void
+Canvas::set_client_name(const ClientID& id, const std::string& name)
+{
+  auto i = _module_index.find(id);
+  for (; i != _module_index.end() && i->first == id; ++i) {
+    i->second->set_name(name);
+  }
+}
+
+void
+Canvas::schedule_regroup(const ClientID& id)
+{
+  _regroup_clients.insert(id);
+}
+
+void
+Canvas::regroup_clients(Configuration& conf, const Metadata& metadata)
+{
+  // Modules are only replaced here, outside any of their own event handlers
+  const auto clients = std::move(_regroup_clients);
+
+  _regroup_clients.clear();
+  for (const auto& id : clients) {
+    regroup_client(conf, metadata, id);
+  }
+}
+
+void
+Canvas::regroup_client(Configuration&  conf,
+                       const Metadata& metadata,
+                       const ClientID& id)
+{
+  // Save the ports and connections of every module for this client
+  std::vector<PortID>  ports;
+  std::set<Connection> connections;
+  auto                 i = _module_index.find(id);
+  for (; i != _module_index.end() && i->first == id; ++i) {
+    for (const auto& connection : connections_on(*i->second)) {
+      connections.insert(connection);
+    }
+
+    for (Ganv::Port* p : *i->second) {
+      if (auto* const port = dynamic_cast<CanvasPort*>(p)) {
+        ports.push_back(port->id());
+        _port_index.erase(port->id());
+      }
+    }
+  }
+
+  // Replace the modules, which also removes their ports and edges
+  remove_module(id);
+  for (const auto& port_id : ports) {
+    if (const auto info = metadata.port(port_id)) {
+      create_port(conf, metadata, port_id, *info);
+    }
+  }
+
+  // Restore the connections between the new ports
+  for (const auto& connection : connections) {
+    CanvasPort* const tail = find_port(connection.tail);
+    CanvasPort* const head = find_port(connection.head);
+    if (tail && head && !get_edge(tail, head)) {
+      auto* const edge = new Ganv::Edge(*this, tail, head);
+
+      const auto c = _pending_changes.find(connection);
+      if (c != _pending_changes.end() && c->second.connect) {
+        set_pending(*edge, true);
+      }
+    }
+  }
+}
+
 CanvasPort*
 Canvas::find_port(const PortID& id)
 {
@@ -253,29 +419,94 @@ Canvas::remove_ports(bool (*pred)(const CanvasPort*))
 void
 Canvas::on_connect(Ganv::Node* port1, Ganv::Node* port2)
 {
-  auto* const p1 = dynamic_cast<CanvasPort*>(port1);
-  auto* const p2 = dynamic_cast<CanvasPort*>(port2);
+  if (const auto connection = edge_connection(port1, port2)) {
+    show_connect(*connection);
+    _action_sink(action::ConnectPorts{connection->tail, connection->head});
+  }
+}
 
-  if (p1 && p2) {
-    if (p1->is_output() && p2->is_input()) {
-      _action_sink(action::ConnectPorts{p1->id(), p2->id()});
-    } else if (p2->is_output() && p1->is_input()) {
-      _action_sink(action::ConnectPorts{p2->id(), p1->id()});
+void
+Canvas::on_disconnect(Ganv::Node* port1, Ganv::Node* port2)
+{
+  if (const auto connection = edge_connection(port1, port2)) {
+    show_disconnect(*connection);
+    _action_sink(action::DisconnectPorts{connection->tail, connection->head});
+  }
+}
+
+void
+Canvas::show_connect(const Connection& connection)
+{
+  CanvasPort* const tail = find_port(connection.tail);
+  CanvasPort* const head = find_port(connection.head);
+
+  // Only show new connections, an existing one may not be removed on failure
+  if (tail && head && !get_edge(tail, head)) {
+    auto* const edge = new Ganv::Edge(*this, tail, head);
+    set_pending(*edge, true);
+
+    _pending_changes[connection] = {true, Clock::now() + change_timeout};
+  }
+}
+
+void
+Canvas::show_disconnect(const Connection& connection)
+{
+  CanvasPort* const tail = find_port(connection.tail);
+  CanvasPort* const head = find_port(connection.head);
+
+  if (tail && head && get_edge(tail, head)) {
+    remove_edge_between(tail, head);
+
+    _pending_changes[connection] = {false, Clock::now() + change_timeout};
+  }
+}
+
+void
+Canvas::roll_back(const Connection&    connection,
+                  const PendingChange& change,
+                  const char* const    reason)
+{
+  CanvasPort* const tail = find_port(connection.tail);
+  CanvasPort* const head = find_port(connection.head);
+  if (!tail || !head) {
+    return; // Port removed since, so there's nothing to undo
+  }
+
+  if (change.connect) {
+    remove_edge_between(tail, head);
+    _log.warning(
+      fmt::format("Removed connection {} ({})", connection, reason));
+  } else {
+    if (!get_edge(tail, head)) {
+      new Ganv::Edge(*this, tail, head);
     }
+
+    _log.warning(
+      fmt::format("Restored connection {} ({})", connection, reason));
   }
 }
 
 void
-Canvas::on_disconnect(Ganv::Node* port1, Ganv::Node* port2)
+Canvas::reject_change(const Connection& connection, const bool connect)
 {
-  auto* const p1 = dynamic_cast<CanvasPort*>(port1);
-  auto* const p2 = dynamic_cast<CanvasPort*>(port2);
+  const auto c = _pending_changes.find(connection);
+  if (c != _pending_changes.end() && c->second.connect == connect) {
+    roll_back(c->first, c->second, "failed");
+    _pending_changes.erase(c);
+  }
+}
 
-  if (p1 && p2) {
-    if (p1->is_output() && p2->is_input()) {
-      _action_sink(action::DisconnectPorts{p1->id(), p2->id()});
-    } else if (p2->is_output() && p1->is_input()) {
-      _action_sink(action::DisconnectPorts{p2->id(), p1->id()});
+void
+Canvas::expire_changes()
+{
+  const auto now = Clock::now();
+  for (auto c = _pending_changes.begin(); c != _pending_changes.end();) {
+    if (c->second.deadline <= now) {
+      roll_back(c->first, c->second, "timed out");
+      c = _pending_changes.erase(c);
+    } else {
+      ++c;
     }
   }
 }
@@ -301,22 +532,56 @@ Canvas::add_module(const ClientID& id, CanvasModule* module)
   }
 }
 
-void
-disconnect_edge(GanvEdge* edge, void* data)
+std::vector<Connection>
+Canvas::connections()
 {
-  auto*       canvas = static_cast<Canvas*>(data);
-  Ganv::Edge* edgemm = Glib::wrap(edge);
+  std::vector<Connection> connections;
+  for_each_edge(collect_edge, &connections);
+  return connections;
+}
 
-  if (canvas && edgemm) {
-    canvas->on_disconnect(edgemm->get_tail(), edgemm->get_head());
+std::vector<Connection>
+Canvas::connections_on(CanvasModule& module)
+{
+  std::vector<Connection> connections;
+  for (Ganv::Port* port : module) {
+    if (port) {
+      for_each_edge_on(GANV_NODE(port->gobj()), collect_edge, &connections);
+    }
   }
+
+  return connections;
+}
+
+std::vector<Connection>
+Canvas::connections_on(CanvasPort& port)
+{
+  std::vector<Connection> connections;
+  for_each_edge_on(GANV_NODE(port.gobj()), collect_edge, &connections);
+  return connections;
+}
+
+std::vector<Connection>
+Canvas::selected_connections()
+{
+  std::vector<Connection> connections;
+  for_each_selected_edge(collect_edge, &connections);
+  return connections;
 }
 
 bool
 Canvas::on_event(GdkEvent* ev)
 {
   if (ev->type == GDK_KEY_PRESS && ev->key.keyval == GDK_KEY_Delete) {
-    for_each_selected_edge(disconnect_edge, this);
+    auto connections = selected_connections();
+    if (!connections.empty()) {
+      for (const auto& connection : connections) {
+        show_disconnect(connection);
+      }
+
+      _action_sink(action::DisconnectMany{std::move(connections)});
+    }
+
     clear_selection();
     return true;
   }
@@ -327,15 +592,105 @@ Canvas::on_event(GdkEvent* ev)
 bool
 Canvas::make_connection(Ganv::Node* tail, Ganv::Node* head)
 {
-  new Ganv::Edge(*this, tail, head);
+  if (Ganv::Edge* const edge = get_edge(tail, head)) {
+    set_pending(*edge, false);
+  } else {
+    new Ganv::Edge(*this, tail, head);
+  }
+
+  if (const auto connection = edge_connection(tail, head)) {
+    _pending_changes.erase(*connection);
+    _stale_connections.erase(*connection);
+  }
+
   return true;
 }
 
+void
+Canvas::remove_connection(Ganv::Node* tail, Ganv::Node* head)
+{
+  remove_edge_between(tail, head);
+
+  if (const auto connection = edge_connection(tail, head)) {
+    _pending_changes.erase(*connection);
+  }
+}
+
+void
+Canvas::mark_stale()
+{
+  for (const auto& entry : _port_index) {
+    _stale_ports.insert(entry.first);
+    set_stale(*entry.second, true);
+  }
+
+  for (const auto& connection : connections()) {
+    CanvasPort* const tail = find_port(connection.tail);
+    CanvasPort* const head = find_port(connection.head);
+    if (Ganv::Edge* const edge = get_edge(tail, head)) {
+      _stale_connections.insert(connection);
+      set_pending(*edge, true);
+    }
+  }
+}
+
+void
+Canvas::remove_stale()
+{
+  for (const auto& connection : _stale_connections) {
+    CanvasPort* const tail = find_port(connection.tail);
+    CanvasPort* const head = find_port(connection.head);
+    if (tail && head) {
+      remove_edge_between(tail, head);
+    }
+  }
+
+  std::set<ClientID> clients;
+  for (const auto& id : _stale_ports) {
+    clients.insert(id.client());
+    remove_port(id);
+  }
+
+  // Remove modules that only had stale ports
+  for (const auto& client : clients) {
+    auto i = _module_index.find(client);
+    while (i != _module_index.end() && i->first == client) {
+      if (i->second->num_ports() == 0) {
+        delete i->second;
+        i = _module_index.erase(i);
+      } else {
+        ++i;
+      }
+    }
+  }
+
+  _stale_connections.clear();
+  _stale_ports.clear();
+}
+
+void
+Canvas::set_monitored(const PortID& id, const bool monitored)
+{
+  if (monitored) {
+    _monitored_ports.insert(id);
+  } else {
+    _monitored_ports.erase(id);
+  }
+
+  if (CanvasPort* const port = find_port(id)) {
+    port->set_monitored(monitored);
+  }
+}
+
 void
 Canvas::clear()
 {
   _port_index.clear();
   _module_index.clear();
+  _regroup_clients.clear();
+  _pending_changes.clear();
+  _stale_ports.clear();
+  _stale_connections.clear();
   Ganv::Canvas::clear();
 }
 
@@ -6,6 +6,7 @@
 
 #include "ActionSink.hpp"
 #include "ClientID.hpp"
+#include "Connection.hpp"
 #include "PortID.hpp"
 #include "warnings.hpp"
 
@@ -16,8 +17,12 @@ PATCHAGE_RESTORE_WARNINGS
 
 #include <gdk/gdk.h>
 
+#include <chrono>
 #include <map>
 #include <random>
+#include <set>
+#include <string>
+#include <vector>
 
 namespace Ganv {
 class Node;
@@ -45,26 +50,89 @@ public:
                           const PortID&   id,
                           const PortInfo& info);
 
+  CanvasPort* update_port(Configuration&  conf,
+                          const Metadata& metadata,
+                          const PortID&   id,
+                          const PortInfo& info);
+
   CanvasModule* find_module(const ClientID& id, SignalDirection type);
   CanvasPort*   find_port(const PortID& id);
 
   void remove_module(const ClientID& id);
 
+  void set_client_name(const ClientID& id, const std::string& name);
+
+  /// Move the ports of a client to new modules when it is next regrouped
+  void schedule_regroup(const ClientID& id);
+
+  /// Move the ports of scheduled clients to modules that match their split
+  void regroup_clients(Configuration& conf, const Metadata& metadata);
+
   void remove_ports(bool (*pred)(const CanvasPort*));
 
   void add_module(const ClientID& id, CanvasModule* module);
 
+  /// Show a connection made by the system, confirming it if it was pending
   bool make_connection(Ganv::Node* tail, Ganv::Node* head);
 
+  /// Remove a connection removed by the system, confirming it if pending
+  void remove_connection(Ganv::Node* tail, Ganv::Node* head);
+
+  /// Undo a pending change to a connection that the system has rejected
+  void reject_change(const Connection& connection, bool connect);
+
+  /// Undo pending changes that the system has not confirmed in time
+  void expire_changes();
+
   void remove_port(const PortID& id);
 
+  /// Return all connections between ports on the canvas
+  std::vector<Connection> connections();
+
+  /// Return all connections to or from the ports of a module
+  std::vector<Connection> connections_on(CanvasModule& module);
+
+  /// Return all connections to or from a port
+  std::vector<Connection> connections_on(CanvasPort& port);
+
+  /// Return all selected connections
+  std::vector<Connection> selected_connections();
+
+  /// Mark everything as stale, so it is removed unless the system confirms it
+  void mark_stale();
+
+  /// Remove all ports and connections that are still stale
+  void remove_stale();
+
+  /// Set whether the level of a port is shown, including if it reappears
+  void set_monitored(const PortID& id, bool monitored);
+
+  /// Return the set of ports that are currently monitored
+  const std::set<PortID>& monitored_ports() const { return _monitored_ports; }
+
   void clear() override;
 
 private:
+  using Clock       = std::chrono::steady_clock;
   using PortIndex   = std::map<const PortID, CanvasPort*>;
   using ModuleIndex = std::multimap<const ClientID, CanvasModule*>;
 
-  friend void disconnect_edge(GanvEdge*, void*);
+  /// A change made by the user that is shown before the system confirms it
+  struct PendingChange {
+    bool              connect;  ///< True if connecting, false if disconnecting
+    Clock::time_point deadline; ///< Time to undo the change if unconfirmed
+  };
+
+  void show_connect(const Connection& connection);
+  void show_disconnect(const Connection& connection);
+
+  void regroup_client(Configuration&  conf,
+                      const Metadata& metadata,
+                      const ClientID& id);
+
+  void roll_back(const Connection&    connection,
+                 const PendingChange& change,
+                 const char*          reason);
 
   bool on_event(GdkEvent* ev);
 
@@ -76,6 +144,12 @@ private:
   PortIndex   _port_index;
   ModuleIndex _module_index;
 
+  std::set<PortID>                    _monitored_ports;
+  std::set<ClientID>                  _regroup_clients;
+  std::map<Connection, PendingChange> _pending_changes;
+  std::set<PortID>                    _stale_ports;
+  std::set<Connection>                _stale_connections;
+
   std::minstd_rand _rng;
 };
 
@@ -48,6 +48,13 @@ CanvasModule::CanvasModule(Canvas&            canvas,
   signal_moved().connect(sigc::mem_fun(this, &CanvasModule::on_moved));
 }
 
+void
+CanvasModule::set_name(const std::string& name)
+{
+  _name = name;
+  set_label(name.c_str());
+}
+
 void
 CanvasModule::update_menu()
 {
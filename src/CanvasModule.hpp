@@ -51,6 +51,8 @@ public:
 
   CanvasPort* get_port(const PortID& id);
 
+  void set_name(const std::string& name);
+
   SignalDirection    type() const { return _type; }
   const ClientID&    id() const { return _id; }
   const std::string& name() const { return _name; }
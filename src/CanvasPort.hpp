@@ -4,6 +4,9 @@
 #ifndef PATCHAGE_CANVASPORT_HPP
 #define PATCHAGE_CANVASPORT_HPP
 
+#include "Action.hpp"
+#include "ActionSink.hpp"
+#include "PortActivity.hpp"
 #include "PortID.hpp"
 #include "PortType.hpp"
 #include "i18n.hpp"
@@ -21,6 +24,8 @@ PATCHAGE_RESTORE_WARNINGS
 #include <sigc++/functors/mem_fun.h>
 #include <sigc++/signal.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <optional>
 #include <string>
@@ -37,6 +42,7 @@ class CanvasPort : public Ganv::Port
 {
 public:
   CanvasPort(Ganv::Module&      module,
+             ActionSink&        action_sink,
              PortType           type,
              PortID             id,
              const std::string& name,
@@ -49,6 +55,7 @@ public:
            (show_human_name && !human_name.empty()) ? human_name : name,
            is_input,
            color)
+    , _action_sink(action_sink)
     , _type(type)
     , _id(std::move(id))
     , _name(name)
@@ -75,6 +82,15 @@ public:
     }
   }
 
+  void set_names(const std::string& name,
+                 const std::string& human_name,
+                 bool               show_human)
+  {
+    _name       = name;
+    _human_name = human_name;
+    show_human_name(show_human);
+  }
+
   bool on_event(GdkEvent* ev) override
   {
     if (ev->type != GDK_BUTTON_PRESS || ev->button.button != 3) {
@@ -85,22 +101,94 @@ public:
     menu->items().push_back(Gtk::Menu_Helpers::MenuElem(
       T("Disconnect"), sigc::mem_fun(this, &Port::disconnect)));
 
+    if (!is_input() && _type != PortType::jack_osc) {
+      menu->items().push_back(Gtk::Menu_Helpers::MenuElem(
+        _monitored ? T("Stop Monitoring") : T("Monitor"),
+        sigc::mem_fun(this, &CanvasPort::on_toggle_monitor)));
+    }
+
     menu->popup(ev->button.button, ev->button.time);
     return true;
   }
 
+  /// Show or hide the level meter or activity LED for this port
+  void set_monitored(const bool monitored)
+  {
+    if (monitored == _monitored) {
+      return;
+    }
+
+    _monitored = monitored;
+    if (monitored) {
+      set_control_is_toggle(is_midi());
+      set_control_min(0.0f);
+      set_control_max(1.0f);
+      set_control_value(0.0f);
+      show_control();
+    } else {
+      hide_control();
+      set_clipping(false);
+    }
+  }
+
+  /// Update the level meter or activity LED with recent activity
+  void set_activity(const PortActivity& activity)
+  {
+    if (!_monitored) {
+      return;
+    }
+
+    if (is_midi()) {
+      // Light up like an LED if any events arrived since the last update
+      set_control_value(activity.n_events ? 1.0f : 0.0f);
+      return;
+    }
+
+    // Show RMS on a logarithmic scale from -60 to 0 dBFS
+    const float db = 20.0f * std::log10(std::max(activity.rms, 1.0e-6f));
+
+    set_control_value(std::clamp((db + 60.0f) / 60.0f, 0.0f, 1.0f));
+    set_clipping(activity.peak >= 1.0f);
+  }
+
   PortType                  type() const { return _type; }
   const PortID&             id() const { return _id; }
   const std::string&        name() const { return _name; }
   const std::string&        human_name() const { return _human_name; }
   const std::optional<int>& order() const { return _order; }
+  bool                      monitored() const { return _monitored; }
 
 private:
+  void on_toggle_monitor()
+  {
+    if (_monitored) {
+      _action_sink(action::UnmonitorPort{_id});
+    } else {
+      _action_sink(action::MonitorPort{_id});
+    }
+  }
+
+  bool is_midi() const
+  {
+    return _type == PortType::jack_midi || _type == PortType::alsa_midi;
+  }
+
+  void set_clipping(const bool clipping)
+  {
+    if (clipping != _clipping) {
+      _clipping = clipping;
+      set_highlighted(clipping);
+    }
+  }
+
+  ActionSink&        _action_sink;
   PortType           _type;
   PortID             _id;
   std::string        _name;
   std::string        _human_name;
   std::optional<int> _order;
+  bool               _monitored{false};
+  bool               _clipping{false};
 };
 
 } // namespace patchage
@@ -13,7 +13,9 @@ PATCHAGE_DISABLE_FMT_WARNINGS
 PATCHAGE_RESTORE_WARNINGS
 
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <ostream>
 #include <string>
 #include <utility>
@@ -117,6 +119,25 @@ operator<(const ClientID& lhs, const ClientID& rhs)
 
 } // namespace patchage
 
+namespace std {
+
+template<>
+struct hash<patchage::ClientID> {
+  size_t operator()(const patchage::ClientID& id) const noexcept
+  {
+    switch (id.type()) {
+    case patchage::ClientID::Type::jack:
+      return hash<string>()(id.jack_name());
+    case patchage::ClientID::Type::alsa:
+      return hash<unsigned>()(id.alsa_id());
+    }
+
+    return 0U;
+  }
+};
+
+} // namespace std
+
 template<>
 struct fmt::formatter<patchage::ClientID> : fmt::ostream_formatter {};
 
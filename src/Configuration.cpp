@@ -3,37 +3,79 @@
 
 #include "Configuration.hpp"
 
+#include "ConnectRules.hpp"
 #include "Coord.hpp"
 #include "PortType.hpp"
 #include "Setting.hpp"
 #include "SignalDirection.hpp"
 #include "patchage_config.h"
 
+#include <algorithm>
 #include <cctype>
 #include <cstdlib>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <limits>
+#include <string>
+#include <system_error>
 #include <utility>
 #include <vector>
 
 namespace patchage {
 namespace {
 
+/// Return the user configuration directory, or an empty string
+std::string
+config_directory()
+{
+  const char* xdg_config_home = getenv("XDG_CONFIG_HOME");
+  const char* home            = getenv("HOME");
+
+  // XDG spec
+  if (xdg_config_home) {
+    return xdg_config_home;
+  }
+
+  if (home) {
+    return std::string(home) + "/.config";
+  }
+
+  return {};
+}
+
+/// Return the directory that contains connection snapshots
+std::string
+snapshot_directory()
+{
+  const std::string config_dir = config_directory();
+
+  return config_dir.empty() ? std::string{"snapshots"}
+                            : config_dir + "/patchage/snapshots";
+}
+
+/// Return the path of the cache of the last known graph
+std::string
+graph_cache_file()
+{
+  const std::string config_dir = config_directory();
+
+  return config_dir.empty() ? std::string{"graph.cache"}
+                            : config_dir + "/patchage/graph.cache";
+}
+
 /// Return a vector of filenames in descending order by preference
 std::vector<std::string>
 get_filenames()
 {
   std::vector<std::string> filenames;
 
-  const char* xdg_config_home = getenv("XDG_CONFIG_HOME");
-  const char* home            = getenv("HOME");
+  const char*       home       = getenv("HOME");
+  const std::string config_dir = config_directory();
 
   // XDG spec
-  if (xdg_config_home) {
-    filenames.push_back(std::string(xdg_config_home) + "/patchagerc");
-  } else if (home) {
-    filenames.push_back(std::string(home) + "/.config/patchagerc");
+  if (!config_dir.empty()) {
+    filenames.push_back(config_dir + "/patchagerc");
   }
 
   // Old location
@@ -47,6 +89,28 @@ get_filenames()
   return filenames;
 }
 
+/**
+   Read a quoted string after any other text on the line.
+
+   Only a quote or backslash can be escaped with a backslash, other
+   backslashes are kept as they are, so regular expressions can be written
+   naturally.
+*/
+void
+read_quoted(std::istream& is, std::string& str)
+{
+  is.ignore(std::numeric_limits<std::streamsize>::max(), '"');
+
+  str.clear();
+  for (int c = is.get(); c != EOF && c != '"'; c = is.get()) {
+    if (c == '\\' && (is.peek() == '"' || is.peek() == '\\')) {
+      c = is.get();
+    }
+
+    str += static_cast<char>(c);
+  }
+}
+
 } // namespace
 
 static const char* const port_type_names[Configuration::n_port_types] =
@@ -180,6 +244,34 @@ Configuration::set_module_split(const std::string& name, bool split)
   }
 }
 
+std::string
+Configuration::snapshot_path(const std::string& name) const
+{
+  return snapshot_directory() + "/" + name;
+}
+
+std::string
+Configuration::graph_cache_path() const
+{
+  return graph_cache_file();
+}
+
+std::vector<std::string>
+Configuration::snapshot_names() const
+{
+  std::vector<std::string> names;
+  std::error_code          ec;
+  for (const auto& entry :
+       std::filesystem::directory_iterator{snapshot_directory(), ec}) {
+    if (entry.is_regular_file(ec)) {
+      names.push_back(entry.path().filename().string());
+    }
+  }
+
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
 void
 Configuration::load()
 {
@@ -200,6 +292,7 @@ Configuration::load()
   }
 
   _module_settings.clear();
+  _connect_rules.clear();
   while (file.good()) {
     std::string key;
     if (file.peek() == '\"') {
@@ -279,6 +372,18 @@ Configuration::load()
       file >> loc.y;
 
       set_module_location(name, type, loc);
+    } else if (key == "connect_rule") {
+      ConnectRule rule;
+      read_quoted(file, rule.tail);
+      read_quoted(file, rule.head);
+
+      if (!_connect_rules.add(rule)) {
+        std::cerr << "error: bad pattern `" << rule.tail
+                  << "' in connection rule\n";
+      } else if (!ConnectRules::is_anchored(rule)) {
+        std::cerr << "warning: connection rule pattern `" << rule.tail
+                  << "' has no literal prefix, so it is slow to apply\n";
+      }
     } else {
       std::cerr << "warning: unknown configuration key `" << key << "'\n";
       file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
@@ -295,6 +400,19 @@ Configuration::load()
 
 namespace {
 
+inline void
+write_quoted(std::ofstream& os, const std::string& str)
+{
+  os << '"';
+  for (const char c : str) {
+    if (c == '"' || c == '\\') {
+      os << '\\';
+    }
+    os << c;
+  }
+  os << '"';
+}
+
 inline void
 write_module_position(std::ofstream&     os,
                       const std::string& name,
@@ -368,6 +486,14 @@ Configuration::save()
     }
   }
 
+  for (const auto& rule : _connect_rules.rules()) {
+    file << "connect_rule ";
+    write_quoted(file, rule.tail);
+    file << " ";
+    write_quoted(file, rule.head);
+    file << "\n";
+  }
+
   file.close();
 }
 
@@ -4,6 +4,7 @@
 #ifndef PATCHAGE_CONFIGURATION_HPP
 #define PATCHAGE_CONFIGURATION_HPP
 
+#include "ConnectRules.hpp"
 #include "Coord.hpp"
 #include "Setting.hpp"
 
@@ -15,6 +16,7 @@
 #include <tuple>
 #include <utility>
 #include <variant>
+#include <vector>
 
 namespace patchage {
 
@@ -42,6 +44,18 @@ public:
   void set_module_split(const std::string& name, bool split);
   bool get_module_split(const std::string& name, bool default_val) const;
 
+  /// Return the rules for automatically connecting new ports
+  const ConnectRules& connect_rules() const { return _connect_rules; }
+
+  /// Return the path of the file for a named connection snapshot
+  std::string snapshot_path(const std::string& name) const;
+
+  /// Return the names of all saved connection snapshots, in order
+  std::vector<std::string> snapshot_names() const;
+
+  /// Return the path of the cache of the last known graph
+  std::string graph_cache_path() const;
+
   uint32_t get_port_color(PortType type) const
   {
     return _port_colors[static_cast<unsigned>(type)];
@@ -121,6 +135,7 @@ private:
   };
 
   std::map<std::string, ModuleSettings> _module_settings;
+  ConnectRules                          _connect_rules;
 
   uint32_t _default_port_colors[n_port_types] = {};
   uint32_t _port_colors[n_port_types]         = {};
@@ -0,0 +1,184 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "ConnectRules.hpp"
+
+#include "Connection.hpp"
+#include "Metadata.hpp"
+#include "PortID.hpp"
+#include "PortInfo.hpp"
+#include "PortType.hpp"
+#include "SignalDirection.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <regex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace patchage {
+namespace {
+
+/// Return the literal text that every name matched by a pattern starts with
+std::string
+regex_prefix(const std::string& pattern)
+{
+  if (pattern.find('|') != std::string::npos) {
+    return {}; // Alternatives may start with anything
+  }
+
+  const size_t start = (!pattern.empty() && pattern[0] == '^') ? 1U : 0U;
+
+  size_t end = pattern.find_first_of("\\^$.|?*+()[]{}", start);
+  if (end == std::string::npos) {
+    end = pattern.size();
+  } else if (end > start && strchr("?*{", pattern[end])) {
+    --end; // The last literal character is optional
+  }
+
+  return pattern.substr(start, end - start);
+}
+
+/// Return the literal text that every name made by a head template starts with
+std::string
+template_prefix(const std::string& head)
+{
+  return head.substr(0, head.find('$'));
+}
+
+} // namespace
+
+void
+ConnectRules::PrefixIndex::insert(const std::string& prefix, const size_t rule)
+{
+  rules[prefix].push_back(rule);
+  lengths.insert(prefix.size());
+}
+
+std::vector<size_t>
+ConnectRules::PrefixIndex::candidates(const std::string& name) const
+{
+  std::vector<size_t> result;
+  for (const size_t length : lengths) {
+    if (length > name.size()) {
+      break;
+    }
+
+    const auto r = rules.find(name.substr(0, length));
+    if (r != rules.end()) {
+      result.insert(result.end(), r->second.begin(), r->second.end());
+    }
+  }
+
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+bool
+ConnectRules::add(const ConnectRule& rule)
+{
+  std::regex pattern;
+  try {
+    pattern = std::regex{rule.tail, std::regex::ECMAScript};
+  } catch (const std::regex_error&) {
+    return false;
+  }
+
+  const size_t index = _rules.size();
+
+  _rules.push_back(rule);
+  _tail_patterns.push_back(std::move(pattern));
+  _tail_prefixes.push_back(regex_prefix(rule.tail));
+  _tail_index.insert(_tail_prefixes.back(), index);
+  _head_index.insert(template_prefix(rule.head), index);
+  return true;
+}
+
+bool
+ConnectRules::is_anchored(const ConnectRule& rule)
+{
+  return !regex_prefix(rule.tail).empty();
+}
+
+void
+ConnectRules::clear()
+{
+  _rules.clear();
+  _tail_patterns.clear();
+  _tail_prefixes.clear();
+  _tail_index = {};
+  _head_index = {};
+}
+
+bool
+ConnectRules::matches(const size_t       rule,
+                      const std::string& tail_name,
+                      const std::string& head_name) const
+{
+  std::smatch match;
+  return std::regex_match(tail_name, match, _tail_patterns[rule]) &&
+         match.format(_rules[rule].head) == head_name;
+}
+
+std::vector<Connection>
+ConnectRules::connections(const Metadata& metadata, const PortID& id) const
+{
+  const auto info = metadata.port(id);
+  const auto name = metadata.port_name(id);
+  if (!info || !name) {
+    return {};
+  }
+
+  const bool input =
+    Metadata::port_direction(id, *info) == SignalDirection::input;
+
+  const auto candidates = (input ? _head_index : _tail_index).candidates(*name);
+  if (candidates.empty()) {
+    return {};
+  }
+
+  // Only ports of the same type on the other side can be connected
+  const PortType        type  = info->type;
+  const SignalDirection other =
+    input ? SignalDirection::output : SignalDirection::input;
+
+  std::set<Connection> result;
+  if (!input) {
+    // For a new output, find the input named by every rule that matches it
+    for (const size_t rule : candidates) {
+      std::smatch match;
+      if (std::regex_match(*name, match, _tail_patterns[rule])) {
+        const auto head_name = match.format(_rules[rule].head);
+        metadata.each_port_named(
+          type,
+          other,
+          head_name,
+          [&](const PortID& other_id, const std::string& other_name) {
+            if (other_name == head_name) {
+              result.insert(Connection{id, other_id});
+            }
+          });
+      }
+    }
+  } else {
+    // For a new input, match only the outputs with the prefix of each rule
+    for (const size_t rule : candidates) {
+      metadata.each_port_named(
+        type,
+        other,
+        _tail_prefixes[rule],
+        [&](const PortID& other_id, const std::string& other_name) {
+          if (matches(rule, other_name, *name)) {
+            result.insert(Connection{other_id, id});
+          }
+        });
+    }
+  }
+
+  return {result.begin(), result.end()};
+}
+
+} // namespace patchage
@@ -0,0 +1,93 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PATCHAGE_CONNECTRULES_HPP
+#define PATCHAGE_CONNECTRULES_HPP
+
+#include "Connection.hpp"
+
+#include <cstddef>
+#include <regex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace patchage {
+
+struct PortID;
+
+class Metadata;
+
+/**
+   A rule that automatically connects ports by name.
+
+   Port names are the full "client:port" names shown for JACK, and the same
+   form made from the client and port labels for ALSA.  Groups in the tail
+   pattern can be referred to in the head, for example the rule
+   "system:capture_(\d+)" => "looper:in_$1" connects each capture port to the
+   looper input with the same number.
+*/
+struct ConnectRule {
+  std::string tail; ///< Regular expression for output port names
+  std::string head; ///< Input port name, with "$n" for tail groups
+};
+
+/**
+   A compiled set of connection rules.
+
+   Rules are indexed by the literal prefix of their patterns, so finding the
+   rules that may apply to a new port takes a few hash lookups regardless of
+   how many rules there are.  Only those candidates are matched with the full
+   regular expression, against the ports of the right type and direction
+   found by name with Metadata::each_port_named(), so the cost doesn't grow
+   with the number of unrelated ports.
+
+   A pattern that starts with a metacharacter has no prefix, so a new input
+   is checked against every output of its type for that rule.  Such rules
+   are allowed, but the configuration warns about them.
+*/
+class ConnectRules
+{
+public:
+  /// Add a rule, return false if its pattern is invalid
+  bool add(const ConnectRule& rule);
+
+  /// Return true if a rule's pattern starts with literal text to index by
+  static bool is_anchored(const ConnectRule& rule);
+
+  /// Remove all rules
+  void clear();
+
+  /// Return all rules in the order they were added
+  const std::vector<ConnectRule>& rules() const { return _rules; }
+
+  /// Return the connections that rules make to or from a new port
+  std::vector<Connection> connections(const Metadata& metadata,
+                                      const PortID&   id) const;
+
+private:
+  /// An index of rules by the literal prefix of a pattern
+  struct PrefixIndex {
+    void insert(const std::string& prefix, size_t rule);
+
+    std::vector<size_t> candidates(const std::string& name) const;
+
+    std::unordered_map<std::string, std::vector<size_t>> rules;
+    std::set<size_t>                                     lengths;
+  };
+
+  bool matches(size_t             rule,
+               const std::string& tail_name,
+               const std::string& head_name) const;
+
+  std::vector<ConnectRule> _rules;
+  std::vector<std::regex>  _tail_patterns;
+  std::vector<std::string> _tail_prefixes;
+  PrefixIndex              _tail_index;
+  PrefixIndex              _head_index;
+};
+
+} // namespace patchage
+
+#endif // PATCHAGE_CONNECTRULES_HPP
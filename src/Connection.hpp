@@ -0,0 +1,49 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PATCHAGE_CONNECTION_HPP
+#define PATCHAGE_CONNECTION_HPP
+
+#include "PortID.hpp"
+#include "warnings.hpp"
+
+PATCHAGE_DISABLE_FMT_WARNINGS
+#include <fmt/core.h>
+#include <fmt/ostream.h>
+PATCHAGE_RESTORE_WARNINGS
+
+#include <ostream>
+#include <tuple>
+
+namespace patchage {
+
+/// A connection from an output port to an input port
+struct Connection {
+  PortID tail; ///< Output port the signal comes from
+  PortID head; ///< Input port the signal goes to
+};
+
+inline std::ostream&
+operator<<(std::ostream& os, const Connection& connection)
+{
+  return os << connection.tail << " => " << connection.head;
+}
+
+inline bool
+operator==(const Connection& lhs, const Connection& rhs)
+{
+  return lhs.tail == rhs.tail && lhs.head == rhs.head;
+}
+
+inline bool
+operator<(const Connection& lhs, const Connection& rhs)
+{
+  return std::tie(lhs.tail, lhs.head) < std::tie(rhs.tail, rhs.head);
+}
+
+} // namespace patchage
+
+template<>
+struct fmt::formatter<patchage::Connection> : fmt::ostream_formatter {};
+
+#endif // PATCHAGE_CONNECTION_HPP
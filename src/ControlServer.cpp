@@ -0,0 +1,642 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "ControlServer.hpp"
+
+#include "Action.hpp"
+#include "ActionSink.hpp"
+#include "ClientID.hpp"
+#include "ClientType.hpp"
+#include "Connection.hpp"
+#include "Event.hpp"
+#include "Graph.hpp"
+#include "ILog.hpp"
+#include "Metadata.hpp"
+#include "PortID.hpp"
+#include "PortInfo.hpp"
+#include "PortType.hpp"
+#include "SignalDirection.hpp"
+#include "encode_event.hpp"
+#include "warnings.hpp"
+
+PATCHAGE_DISABLE_FMT_WARNINGS
+#include <fmt/core.h>
+PATCHAGE_RESTORE_WARNINGS
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#ifdef MSG_NOSIGNAL
+#  define PATCHAGE_SEND_FLAGS MSG_NOSIGNAL
+#else
+#  define PATCHAGE_SEND_FLAGS 0
+#endif
+
+namespace patchage {
+namespace {
+
+/// Most bytes queued for a subscriber before it is considered too slow
+constexpr size_t max_subscriber_buffer = 1U << 20U;
+
+/// Most bytes a client may send in a single batch of commands
+constexpr size_t max_batch_size = 1U << 20U;
+
+/// Time to wait for connection changes, which may be queued behind others
+constexpr auto change_timeout = std::chrono::seconds{30};
+
+/// Create a directory if necessary, return true if only the user can use it
+bool
+make_private_dir(const std::string& path)
+{
+  if (mkdir(path.c_str(), S_IRWXU) && errno != EEXIST) {
+    return false;
+  }
+
+  struct stat st{};
+  return !lstat(path.c_str(), &st) && S_ISDIR(st.st_mode) &&
+         st.st_uid == getuid() && !(st.st_mode & (S_IRWXG | S_IRWXO));
+}
+
+/// Split a command line into words, which may be quoted with escapes
+std::vector<std::string>
+tokenize(const std::string& line)
+{
+  std::vector<std::string> tokens;
+  size_t                   i = 0U;
+  while (i < line.size()) {
+    if (isspace(static_cast<unsigned char>(line[i]))) {
+      ++i;
+    } else if (line[i] == '"') {
+      std::string token;
+      for (++i; i < line.size() && line[i] != '"'; ++i) {
+        if (line[i] == '\\' && i + 1 < line.size()) {
+          ++i;
+        }
+
+        token += line[i];
+      }
+
+      tokens.push_back(std::move(token));
+      ++i;
+    } else {
+      const size_t start = i;
+      while (i < line.size() && !isspace(static_cast<unsigned char>(line[i]))) {
+        ++i;
+      }
+
+      tokens.push_back(line.substr(start, i - start));
+    }
+  }
+
+  return tokens;
+}
+
+/// Return a string quoted so that tokenize() reads it back as one word
+std::string
+quote(const std::string& str)
+{
+  std::string result = "\"";
+  for (const char c : str) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+    }
+
+    result += c;
+  }
+
+  return result + "\"";
+}
+
+std::optional<uint8_t>
+parse_byte(const std::string& str)
+{
+  char*               end   = nullptr;
+  const unsigned long value = strtoul(str.c_str(), &end, 10);
+  if (str.empty() || *end || value > 255U) {
+    return {};
+  }
+
+  return static_cast<uint8_t>(value);
+}
+
+/// Parse a port ID in the form written by its output operator
+std::optional<PortID>
+parse_port_id(const std::string& str)
+{
+  if (str.rfind("jack:", 0U) == 0U) {
+    const std::string name  = str.substr(5U);
+    const size_t      colon = name.find(':');
+    if (colon == std::string::npos || colon == 0U ||
+        colon == name.size() - 1U) {
+      return {};
+    }
+
+    return PortID::jack(name);
+  }
+
+  if (str.rfind("alsa:", 0U) == 0U) {
+    std::istringstream ss{str.substr(5U)};
+    std::string        client;
+    std::string        port;
+    std::string        direction;
+    std::getline(ss, client, ':');
+    std::getline(ss, port, ':');
+    std::getline(ss, direction);
+
+    const auto client_id = parse_byte(client);
+    const auto port_id   = parse_byte(port);
+    if (client_id && port_id && (direction == "in" || direction == "out")) {
+      return PortID::alsa(*client_id, *port_id, direction == "in");
+    }
+  }
+
+  return {};
+}
+
+/// Parse a client ID in the form written by its output operator
+std::optional<ClientID>
+parse_client_id(const std::string& str)
+{
+  if (str.rfind("jack:", 0U) == 0U && str.size() > 5U) {
+    return ClientID::jack(str.substr(5U));
+  }
+
+  if (str.rfind("alsa:", 0U) == 0U) {
+    if (const auto id = parse_byte(str.substr(5U))) {
+      return ClientID::alsa(*id);
+    }
+  }
+
+  return {};
+}
+
+const char*
+port_type_name(const PortType type)
+{
+  switch (type) {
+  case PortType::jack_audio:
+    return "jack_audio";
+  case PortType::jack_midi:
+    return "jack_midi";
+  case PortType::alsa_midi:
+    return "alsa_midi";
+  case PortType::jack_osc:
+    return "jack_osc";
+  case PortType::jack_cv:
+    return "jack_cv";
+  }
+
+  return "unknown";
+}
+
+} // namespace
+
+ControlServer::ControlServer(ILog&           log,
+                             const Graph&    graph,
+                             const Metadata& metadata,
+                             ActionSink      action_sink)
+  : _log{log}
+  , _graph{graph}
+  , _metadata{metadata}
+  , _action_sink{std::move(action_sink)}
+{}
+
+ControlServer::~ControlServer()
+{
+  for (const auto& client : _clients) {
+    close(client.fd);
+  }
+
+  if (_fd >= 0) {
+    close(_fd);
+    unlink(_path.c_str());
+  }
+}
+
+std::string
+ControlServer::default_path()
+{
+  if (const char* const runtime_dir = getenv("XDG_RUNTIME_DIR")) {
+    return std::string{runtime_dir} + "/patchage.sock";
+  }
+
+  return fmt::format("/tmp/patchage-{}/patchage.sock", getuid());
+}
+
+bool
+ControlServer::listen(const std::string& path)
+{
+  sockaddr_un addr{};
+  if (path.size() >= sizeof(addr.sun_path)) {
+    _log.error(fmt::format(u8"Socket path “{}” is too long", path));
+    return false;
+  }
+
+  addr.sun_family = AF_UNIX;
+  memcpy(addr.sun_path, path.c_str(), path.size() + 1U);
+
+  // Only listen in a directory that other users can't get into
+  const size_t      slash = path.rfind('/');
+  const std::string dir =
+    (slash == std::string::npos) ? "." : path.substr(0U, slash ? slash : 1U);
+  if (!make_private_dir(dir)) {
+    _log.error(fmt::format(
+      u8"Socket directory “{}” is not private to this user", dir));
+    return false;
+  }
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    _log.error(fmt::format("Failed to create socket ({})", strerror(errno)));
+    return false;
+  }
+
+  // Replace a stale socket, but not one that another instance is using
+  auto* const address = reinterpret_cast<const sockaddr*>(&addr);
+  if (!connect(fd, address, sizeof(addr))) {
+    _log.warning(fmt::format(u8"Socket “{}” is already in use", path));
+    close(fd);
+    return false;
+  }
+
+  unlink(path.c_str());
+  if (bind(fd, address, sizeof(addr)) ||
+      chmod(path.c_str(), S_IRUSR | S_IWUSR) || ::listen(fd, 8) ||
+      fcntl(fd, F_SETFL, O_NONBLOCK) || fcntl(fd, F_SETFD, FD_CLOEXEC)) {
+    _log.error(fmt::format(
+      u8"Failed to listen on socket “{}” ({})", path, strerror(errno)));
+    close(fd);
+    return false;
+  }
+
+  _fd   = fd;
+  _path = path;
+  _log.info(fmt::format(u8"Listening for commands on “{}”", path));
+  return true;
+}
+
+void
+ControlServer::poll()
+{
+  if (_fd < 0) {
+    return;
+  }
+
+  // Accept any new clients
+  int fd = -1;
+  while ((fd = accept(_fd, nullptr, nullptr)) >= 0) {
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    _clients.push_back(Client{fd, {}, {}, false, false, 0U, {}});
+  }
+
+  const auto now = Clock::now();
+  for (auto c = _clients.begin(); c != _clients.end();) {
+    bool ok = read_client(*c);
+
+    // Handle every complete batch, and the rest once the client is done
+    size_t end = 0U;
+    while (ok && !c->subscribed &&
+           (end = c->input.find("\n\n")) != std::string::npos) {
+      const std::string batch = c->input.substr(0U, end + 1U);
+      c->input.erase(0U, end + 2U);
+      handle_batch(*c, batch);
+    }
+
+    if (ok && !c->subscribed && c->eof &&
+        c->input.find_first_not_of(" \t\r\n") != std::string::npos) {
+      const std::string batch = std::move(c->input);
+      c->input.clear();
+      handle_batch(*c, batch);
+    }
+
+    // Subscribers only listen, so anything else they send is ignored
+    if (c->subscribed) {
+      c->input.clear();
+    }
+
+    // Drop clients that send more than any reasonable batch
+    if (ok && c->input.size() > max_batch_size) {
+      _log.warning("Disconnected control client that sent too large a batch");
+      ok = false;
+    }
+
+    // Send any replies that were waiting for changes that are done
+    send_finished_replies(*c, now);
+
+    ok = ok && write_client(*c);
+    if (!ok || (c->eof && c->output.empty() && c->pending.empty() &&
+                !c->subscribed)) {
+      close(c->fd);
+      c = _clients.erase(c);
+    } else {
+      ++c;
+    }
+  }
+}
+
+bool
+ControlServer::read_client(Client& client)
+{
+  // Stop once there's more than a batch, leaving the rest in the socket
+  char buf[4096];
+  while (!client.eof && client.input.size() <= max_batch_size) {
+    const ssize_t n = read(client.fd, buf, sizeof(buf));
+    if (n > 0) {
+      client.input.append(buf, static_cast<size_t>(n));
+    } else if (n == 0) {
+      client.eof = true;
+    } else {
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+  }
+
+  return true;
+}
+
+bool
+ControlServer::write_client(Client& client)
+{
+  while (!client.output.empty()) {
+    const ssize_t n = send(client.fd,
+                           client.output.data(),
+                           client.output.size(),
+                           PATCHAGE_SEND_FLAGS);
+    if (n > 0) {
+      client.output.erase(0U, static_cast<size_t>(n));
+      client.backlog -= std::min(client.backlog, static_cast<size_t>(n));
+    } else {
+      return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+  }
+
+  return true;
+}
+
+void
+ControlServer::publish(const std::vector<Event>& events)
+{
+  if (events.empty()) {
+    return;
+  }
+
+  std::string frames;
+  for (const auto& event : events) {
+    if (const auto* const e = std::get_if<event::DriverAttached>(&event)) {
+      _attached.insert(e->type);
+    } else if (const auto* const d =
+                 std::get_if<event::DriverDetached>(&event)) {
+      _attached.erase(d->type);
+    } else if (const auto* const pc =
+                 std::get_if<event::PortsConnected>(&event)) {
+      finish_change(true, {pc->tail, pc->head}, true);
+    } else if (const auto* const cf =
+                 std::get_if<event::ConnectFailed>(&event)) {
+      finish_change(true, {cf->tail, cf->head}, false);
+    } else if (const auto* const pd =
+                 std::get_if<event::PortsDisconnected>(&event)) {
+      finish_change(false, {pd->tail, pd->head}, true);
+    } else if (const auto* const df =
+                 std::get_if<event::DisconnectFailed>(&event)) {
+      finish_change(false, {df->tail, df->head}, false);
+    }
+
+    encode_event(frames, event);
+  }
+
+  for (auto c = _clients.begin(); c != _clients.end();) {
+    if (!c->subscribed) {
+      ++c;
+    } else if (c->output.size() - c->backlog + frames.size() >
+               max_subscriber_buffer) {
+      _log.warning("Disconnected event subscriber that fell behind");
+      close(c->fd);
+      c = _clients.erase(c);
+    } else {
+      c->output += frames;
+      ++c;
+    }
+  }
+}
+
+void
+ControlServer::finish_change(const bool        connect,
+                             const Connection& connection,
+                             const bool        ok)
+{
+  for (auto& client : _clients) {
+    for (auto& reply : client.pending) {
+      if (reply.connect == connect && reply.remaining.erase(connection)) {
+        if (!ok) {
+          reply.failed.push_back(connection);
+        }
+      }
+    }
+  }
+}
+
+void
+ControlServer::append_output(Client& client, const std::string& text)
+{
+  // Keep everything after a held reply in order behind it
+  if (client.pending.empty()) {
+    client.output += text;
+  } else {
+    client.pending.back().rest += text;
+  }
+}
+
+void
+ControlServer::send_finished_replies(Client&                 client,
+                                     const Clock::time_point now)
+{
+  // Give up on any changes that haven't been confirmed in time
+  for (auto& reply : client.pending) {
+    if (reply.deadline <= now) {
+      reply.failed.insert(
+        reply.failed.end(), reply.remaining.begin(), reply.remaining.end());
+      reply.remaining.clear();
+    }
+  }
+
+  while (!client.pending.empty() && client.pending.front().remaining.empty()) {
+    const PendingReply& reply = client.pending.front();
+    for (const auto& connection : reply.failed) {
+      client.output += fmt::format("failed {} {}\n",
+                                   quote(fmt::format("{}", connection.tail)),
+                                   quote(fmt::format("{}", connection.head)));
+    }
+
+    if (reply.failed.empty()) {
+      client.output += "ok\n";
+    } else {
+      client.output += fmt::format("error: failed to {}\n",
+                                   reply.connect ? "connect" : "disconnect");
+    }
+
+    client.output += reply.rest;
+    client.pending.pop_front();
+  }
+}
+
+void
+ControlServer::handle_batch(Client& client, const std::string& batch)
+{
+  std::string output;
+
+  // Send any output so far, in order after any replies that are held
+  const auto flush_output = [&] {
+    append_output(client, output);
+    output.clear();
+  };
+
+  // Gather consecutive changes of the same kind into a single action
+  std::vector<Connection> changes;
+  bool                    connecting = false;
+
+  const auto flush = [&] {
+    if (!changes.empty()) {
+      if (connecting) {
+        _action_sink(action::ConnectMany{std::move(changes)});
+      } else {
+        _action_sink(action::DisconnectMany{std::move(changes)});
+      }
+
+      changes.clear();
+    }
+  };
+
+  // Queue the changes that aren't already made, and hold the reply for them
+  const auto add_changes = [&](const bool                     connect,
+                               const std::vector<Connection>& connections) {
+    PendingReply reply{connect, {}, {}, Clock::now() + change_timeout, {}};
+    for (const auto& c : connections) {
+      if (_graph.connected(c.tail, c.head) != connect) {
+        reply.remaining.insert(c);
+      }
+    }
+
+    if (reply.remaining.empty()) {
+      output += "ok\n";
+      return;
+    }
+
+    if (connect != connecting) {
+      flush();
+      connecting = connect;
+    }
+
+    changes.insert(
+      changes.end(), reply.remaining.begin(), reply.remaining.end());
+
+    flush_output();
+    client.pending.push_back(std::move(reply));
+  };
+
+  std::istringstream lines{batch};
+  std::string        line;
+  while (std::getline(lines, line)) {
+    const auto tokens = tokenize(line);
+    if (tokens.empty() || tokens[0][0] == '#') {
+      continue;
+    }
+
+    const std::string& command = tokens[0];
+    if (command == "connect" || command == "disconnect") {
+      if (tokens.size() != 3U) {
+        output += fmt::format("error: {} takes 2 ports\n", command);
+        continue;
+      }
+
+      const auto tail = parse_port_id(tokens[1]);
+      const auto head = parse_port_id(tokens[2]);
+      if (!tail || !_graph.contains(*tail)) {
+        output += fmt::format("error: unknown port {}\n", quote(tokens[1]));
+      } else if (!head || !_graph.contains(*head)) {
+        output += fmt::format("error: unknown port {}\n", quote(tokens[2]));
+      } else {
+        add_changes(command == "connect", {Connection{*tail, *head}});
+      }
+
+    } else if (command == "disconnect-client") {
+      const auto id = (tokens.size() == 2U) ? parse_client_id(tokens[1])
+                                            : std::optional<ClientID>{};
+      if (!id) {
+        output += "error: disconnect-client takes 1 client\n";
+      } else {
+        add_changes(false, _graph.connections_on(*id));
+      }
+
+    } else if (command == "ports") {
+      _metadata.each_port([&](const PortID& id, const PortInfo& info) {
+        const bool is_input = (id.type() == PortID::Type::alsa)
+                                ? id.alsa_is_input()
+                                : info.direction == SignalDirection::input;
+
+        output += fmt::format("port {} {} {}\n",
+                              quote(fmt::format("{}", id)),
+                              port_type_name(info.type),
+                              is_input ? "input" : "output");
+      });
+      output += "ok\n";
+
+    } else if (command == "subscribe") {
+      if (!client.pending.empty()) {
+        output += "error: subscribe after connection changes are done\n";
+      } else {
+        client.subscribed = true;
+        output += "ok\n";
+      }
+
+    } else if (command == "connections") {
+      for (const auto& connection : _graph.connections()) {
+        output += fmt::format("connection {} {}\n",
+                              quote(fmt::format("{}", connection.tail)),
+                              quote(fmt::format("{}", connection.head)));
+      }
+      output += "ok\n";
+
+    } else {
+      output += fmt::format("error: unknown command {}\n", quote(command));
+    }
+  }
+
+  flush();
+  output += "\n";
+
+  if (client.subscribed) {
+    encode_snapshot(output, _metadata, _graph);
+    for (const auto type : _attached) {
+      encode_event(output, event::DriverAttached{type});
+    }
+  }
+
+  flush_output();
+
+  // Let a subscriber receive all of this before limiting its buffer
+  if (client.subscribed) {
+    client.backlog = client.output.size();
+  }
+}
+
+} // namespace patchage
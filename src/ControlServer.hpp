@@ -0,0 +1,130 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PATCHAGE_CONTROLSERVER_HPP
+#define PATCHAGE_CONTROLSERVER_HPP
+
+#include "ActionSink.hpp"
+#include "Connection.hpp"
+#include "Event.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace patchage {
+
+class Graph;
+class ILog;
+class Metadata;
+enum class ClientType;
+
+/**
+   Local socket for controlling connections from scripts.
+
+   Clients send batches of commands, one per line, with each batch ended by
+   an empty line or by closing the connection.  The commands are:
+
+   - connect "TAIL" "HEAD"
+   - disconnect "TAIL" "HEAD"
+   - disconnect-client "CLIENT"
+   - ports
+   - connections
+   - subscribe
+
+   Ports and clients are named by their IDs, like "jack:system:capture_1" or
+   "alsa:20:0:out".  Consecutive connects or disconnects are sent as a single
+   action, so a large batch costs one request to each driver.
+
+   The reply to each command is any data lines, followed by "ok" or
+   "error: MESSAGE", and the reply to a batch is ended by an empty line.
+   Connection changes are made asynchronously, but the reply to a command
+   that makes them is only sent once the drivers have made them all, or
+   reported that some failed, or they time out.  Each change that didn't
+   happen is listed in a "failed TAIL HEAD" line before the error.  Replies
+   are always sent in order, so later ones wait for these as well.
+
+   After the reply to a batch with "subscribe", the connection only gets
+   binary event frames as written by encode_event(), starting with events
+   that describe the current system, then a DriverAttached for each attached
+   driver.  Each subscriber has a bounded buffer for events beyond that
+   snapshot, and is disconnected if it doesn't keep up, so it can reconnect
+   to get a fresh snapshot.
+
+   The server never blocks, poll() is called periodically by the main loop.
+*/
+class ControlServer
+{
+public:
+  ControlServer(ILog&           log,
+                const Graph&    graph,
+                const Metadata& metadata,
+                ActionSink      action_sink);
+
+  ControlServer(const ControlServer&)            = delete;
+  ControlServer& operator=(const ControlServer&) = delete;
+
+  ControlServer(ControlServer&&)            = delete;
+  ControlServer& operator=(ControlServer&&) = delete;
+
+  ~ControlServer();
+
+  /// Return the default socket path for the current user
+  static std::string default_path();
+
+  /// Start listening on a socket, return false on error
+  bool listen(const std::string& path);
+
+  /// Accept new clients and handle any complete batches of commands
+  void poll();
+
+  /// Send events to every subscriber
+  void publish(const std::vector<Event>& events);
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  /// The reply to a command that changes connections, held until they're done
+  struct PendingReply {
+    bool                    connect;   ///< True if connecting
+    std::set<Connection>    remaining; ///< Changes not yet confirmed
+    std::vector<Connection> failed;    ///< Changes that failed
+    Clock::time_point       deadline;  ///< Time to stop waiting for changes
+    std::string             rest;      ///< Output that follows this reply
+  };
+
+  struct Client {
+    int                      fd;
+    std::string              input;
+    std::string              output;
+    bool                     eof;
+    bool                     subscribed;
+    size_t                   backlog; ///< Subscription output not yet sent
+    std::deque<PendingReply> pending; ///< Replies waiting for changes
+  };
+
+  bool read_client(Client& client);
+  bool write_client(Client& client);
+
+  void handle_batch(Client& client, const std::string& batch);
+  void finish_change(bool connect, const Connection& connection, bool ok);
+
+  static void append_output(Client& client, const std::string& text);
+  static void send_finished_replies(Client& client, Clock::time_point now);
+
+  ILog&                _log;
+  const Graph&         _graph;
+  const Metadata&      _metadata;
+  ActionSink           _action_sink;
+  std::string          _path;
+  int                  _fd{-1};
+  std::vector<Client>  _clients;
+  std::set<ClientType> _attached; ///< Drivers attached according to events
+};
+
+} // namespace patchage
+
+#endif // PATCHAGE_CONTROLSERVER_HPP
@@ -4,23 +4,34 @@
 #ifndef PATCHAGE_DRIVER_HPP
 #define PATCHAGE_DRIVER_HPP
 
+#include "Connection.hpp"
 #include "Event.hpp"
+#include "PortActivity.hpp"
+#include "PortID.hpp"
+#include "warnings.hpp"
 
+PATCHAGE_DISABLE_FMT_WARNINGS
+#include <fmt/core.h>
+PATCHAGE_RESTORE_WARNINGS
+
+#include <algorithm>
 #include <functional>
+#include <optional>
+#include <string>
 #include <utility>
+#include <vector>
 
 namespace patchage {
 
-struct PortID;
-
 /// Base class for drivers that handle system clients and ports
 class Driver
 {
 public:
-  using EventSink = std::function<void(const Event&)>;
+  using Events    = std::vector<Event>;
+  using EventSink = std::function<void(Events&& events)>;
 
-  explicit Driver(EventSink emit_event)
-    : _emit_event{std::move(emit_event)}
+  explicit Driver(EventSink emit_events)
+    : _emit_events{std::move(emit_events)}
   {}
 
   Driver(const Driver&)            = delete;
@@ -40,17 +51,90 @@ public:
   /// Return true iff the driver is active and connected to the system
   virtual bool is_attached() const = 0;
 
-  /// Send events to `sink` that describe the complete current system state
+  /// Send a batch of events to `sink` that describes the current system state
   virtual void refresh(const EventSink& sink) = 0;
 
+  /// Emit any "live" events that have been buffered since the last call
+  virtual void flush_events() {}
+
+  /**
+     Make many connections between ports.
+
+     Returns a success flag for each connection, in order.  Failures are
+     logged as a single message for the whole batch.
+  */
+  virtual std::vector<bool>
+  connect_many(const std::vector<Connection>& connections) = 0;
+
+  /**
+     Remove many connections between ports.
+
+     Returns a success flag for each connection, in order.  Failures are
+     logged as a single message for the whole batch.
+  */
+  virtual std::vector<bool>
+  disconnect_many(const std::vector<Connection>& connections) = 0;
+
   /// Make a connection between ports
-  virtual bool connect(const PortID& tail_id, const PortID& head_id) = 0;
+  bool connect(const PortID& tail_id, const PortID& head_id)
+  {
+    return connect_many({Connection{tail_id, head_id}}).front();
+  }
 
   /// Remove a connection between ports
-  virtual bool disconnect(const PortID& tail_id, const PortID& head_id) = 0;
+  bool disconnect(const PortID& tail_id, const PortID& head_id)
+  {
+    return disconnect_many({Connection{tail_id, head_id}}).front();
+  }
+
+  /// Start monitoring the signal on a port, return true on success
+  virtual bool monitor(const PortID& id) = 0;
+
+  /// Stop monitoring the signal on a port
+  virtual void unmonitor(const PortID& id) = 0;
+
+  /// Return and reset the activity on a monitored port since the last call
+  virtual std::optional<PortActivity> activity(const PortID& id) = 0;
 
 protected:
-  EventSink _emit_event; ///< Sink for emitting "live" events
+  /// Emit a single "live" event, prefer emitting batches where possible
+  void emit_event(Event event)
+  {
+    Events events;
+    events.emplace_back(std::move(event));
+    _emit_events(std::move(events));
+  }
+
+  /**
+     Return a message that describes the failures in a batch operation.
+
+     @param what What failed, like "Failed to connect".
+     @param connections The connections in the batch.
+     @param results The success flag for each connection.
+     @param error The reason for the first failure.
+  */
+  static std::string failure_message(const std::string&             what,
+                                     const std::vector<Connection>& connections,
+                                     const std::vector<bool>&       results,
+                                     const std::string&             error)
+  {
+    const auto first  = std::find(results.begin(), results.end(), false);
+    const auto n_fail = std::count(first, results.end(), false);
+    const auto& c     = connections[first - results.begin()];
+
+    if (n_fail == 1) {
+      return fmt::format("{} {} ({})", what, c, error);
+    }
+
+    return fmt::format("{} {} of {} connections, first {} ({})",
+                       what,
+                       n_fail,
+                       connections.size(),
+                       c,
+                       error);
+  }
+
+  EventSink _emit_events; ///< Sink for emitting batches of "live" events
 };
 
 } // namespace patchage
@@ -5,29 +5,81 @@
 
 #include "AudioDriver.hpp"
 #include "ClientType.hpp"
+#include "Connection.hpp"
 #include "Driver.hpp"
 #include "Event.hpp"
+#include "ILog.hpp"
 #include "make_alsa_driver.hpp"
 #include "make_jack_driver.hpp"
+#include "warnings.hpp"
 
+PATCHAGE_DISABLE_FMT_WARNINGS
+#include <fmt/core.h>
+PATCHAGE_RESTORE_WARNINGS
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
 #include <utility>
 #include <variant>
+#include <vector>
 
 namespace patchage {
+namespace {
+
+/// Maximum number of connections made by the worker while holding a driver
+constexpr size_t max_chunk_size = 32U;
+
+/// Group connections by the driver that handles them, dropping invalid ones
+std::map<ClientType, std::vector<Connection>>
+group_connections(const std::vector<Connection>& connections, ILog& log)
+{
+  std::map<ClientType, std::vector<Connection>> groups;
+  for (const auto& connection : connections) {
+    if (connection.tail.type() == connection.head.type()) {
+      groups[connection.tail.type()].push_back(connection);
+    } else {
+      log.warning(
+        fmt::format("Ignoring incompatible connection {}", connection));
+    }
+  }
 
-Drivers::Drivers(ILog& log, Driver::EventSink emit_event)
+  return groups;
+}
+
+} // namespace
+
+Drivers::Drivers(ILog& log, Driver::EventSink emit_events)
   : _log{log}
-  , _emit_event{std::move(emit_event)}
+  , _emit_events{std::move(emit_events)}
   , _alsa_driver{make_alsa_driver(
       log,
-      [this](const Event& event) { _emit_event(event); })}
-  , _jack_driver{make_jack_driver(_log, [this](const Event& event) {
-    _emit_event(event);
-  })}
+      [this](Driver::Events&& events) { _emit_events(std::move(events)); })}
+  , _jack_driver{make_jack_driver(
+      _log,
+      [this](Driver::Events&& events) { _emit_events(std::move(events)); })}
+  , _worker{[this] { run_commands(); }}
 {}
 
 Drivers::~Drivers()
 {
+  join_tasks();
+
+  {
+    const std::lock_guard<std::mutex> lock{_commands_mutex};
+    _exit = true;
+  }
+
+  _commands_cond.notify_all();
+  _worker.join();
+
   if (_alsa_driver) {
     _alsa_driver->detach();
   }
@@ -38,19 +90,364 @@ Drivers::~Drivers()
 }
 
 void
-Drivers::refresh()
+Drivers::attach(const ClientType type, const bool launch_daemon)
+{
+  const std::lock_guard<std::mutex> lock{driver_mutex(type)};
+
+  if (auto* const d = driver(type)) {
+    d->attach(launch_daemon);
+  }
+}
+
+void
+Drivers::attach(const std::vector<ClientType>& types, const bool launch_daemon)
+{
+  // Attaching may start a server, so don't make the others wait for it
+  std::vector<std::thread> threads;
+  for (const auto type : types) {
+    if (driver(type)) {
+      threads.emplace_back([this, type, launch_daemon] {
+        attach(type, launch_daemon);
+      });
+    }
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+void
+Drivers::start_attach(std::vector<ClientType> types,
+                      const bool              launch_daemon,
+                      Done                    done)
+{
+  start_task([this, types = std::move(types), launch_daemon, done] {
+    attach(types, launch_daemon);
+    if (done) {
+      done();
+    }
+  });
+}
+
+void
+Drivers::detach(const ClientType type)
 {
-  _emit_event(event::Cleared{});
+  // Take any commands for this driver that haven't started yet
+  std::vector<Command> cancelled;
+  {
+    const std::lock_guard<std::mutex> lock{_commands_mutex};
+
+    const auto is_cancelled = [type](const Command& c) {
+      return c.type == type;
+    };
+
+    // Stop the running command after its current chunk
+    if (_running == type) {
+      _cancel = true;
+    }
+
+    std::copy_if(_commands.begin(),
+                 _commands.end(),
+                 std::back_inserter(cancelled),
+                 is_cancelled);
+
+    _commands.erase(
+      std::remove_if(_commands.begin(), _commands.end(), is_cancelled),
+      _commands.end());
+  }
+
+  if (!cancelled.empty()) {
+    _log.warning(fmt::format(
+      "Cancelled {} pending {} commands", cancelled.size(), type));
 
+    for (const auto& command : cancelled) {
+      emit_failures(command,
+                    std::vector<bool>(command.connections.size(), false));
+    }
+  }
+
+  // Wait for any running command to finish before detaching
+  const std::lock_guard<std::mutex> lock{driver_mutex(type)};
+
+  if (auto* const d = driver(type)) {
+    d->detach();
+  }
+}
+
+void
+Drivers::flush_events()
+{
   if (_alsa_driver) {
-    _alsa_driver->refresh(_emit_event);
+    _alsa_driver->flush_events();
   }
 
   if (_jack_driver) {
-    _jack_driver->refresh(_emit_event);
+    _jack_driver->flush_events();
+  }
+}
+
+void
+Drivers::connect(const ClientType type, std::vector<Connection> connections)
+{
+  push_command({type, true, std::move(connections)});
+}
+
+void
+Drivers::disconnect(const ClientType type, std::vector<Connection> connections)
+{
+  push_command({type, false, std::move(connections)});
+}
+
+void
+Drivers::connect(const std::vector<Connection>& connections)
+{
+  push_commands(true, connections);
+}
+
+void
+Drivers::disconnect(const std::vector<Connection>& connections)
+{
+  push_commands(false, connections);
+}
+
+void
+Drivers::push_commands(const bool                     connect,
+                       const std::vector<Connection>& connections)
+{
+  for (auto& group : group_connections(connections, _log)) {
+    if (driver(group.first)) {
+      push_command({group.first, connect, std::move(group.second)});
+    } else {
+      _log.error(fmt::format("No driver for {}", group.first));
+    }
   }
 }
 
+void
+Drivers::push_command(Command command)
+{
+  {
+    const std::lock_guard<std::mutex> lock{_commands_mutex};
+    _commands.push_back(std::move(command));
+  }
+
+  _commands_cond.notify_one();
+}
+
+void
+Drivers::run_commands()
+{
+  std::unique_lock<std::mutex> lock{_commands_mutex};
+  while (true) {
+    _commands_cond.wait(lock, [this] { return _exit || !_commands.empty(); });
+    if (_exit) {
+      break;
+    }
+
+    const Command command = std::move(_commands.front());
+    _commands.pop_front();
+    _running = command.type;
+    _cancel  = false;
+    lock.unlock();
+
+    // Run the command in chunks, failing the rest if it is cancelled
+    std::vector<bool> results(command.connections.size(), false);
+    for (size_t start = 0U; start < command.connections.size();
+         start += max_chunk_size) {
+      if (!run_chunk(command, start, results)) {
+        break;
+      }
+    }
+
+    lock.lock();
+    _running.reset();
+    if (_exit) {
+      break;
+    }
+
+    lock.unlock();
+    emit_failures(command, results);
+    lock.lock();
+  }
+}
+
+bool
+Drivers::run_chunk(const Command&     command,
+                   const size_t       start,
+                   std::vector<bool>& results)
+{
+  {
+    const std::lock_guard<std::mutex> lock{_commands_mutex};
+    if (_cancel || _exit) {
+      return false;
+    }
+  }
+
+  const size_t end = std::min(start + max_chunk_size, results.size());
+
+  std::vector<Connection> chunk;
+  for (size_t i = start; i < end; ++i) {
+    chunk.push_back(command.connections[i]);
+  }
+
+  // Run the chunk, or fail it if the driver is detached
+  const std::lock_guard<std::mutex> lock{driver_mutex(command.type)};
+
+  Driver* const d = driver(command.type);
+  if (!d || !d->is_attached()) {
+    return false;
+  }
+
+  const auto chunk_results =
+    command.connect ? d->connect_many(chunk) : d->disconnect_many(chunk);
+
+  for (size_t i = start; i < end; ++i) {
+    results[i] = chunk_results[i - start];
+  }
+
+  return true;
+}
+
+void
+Drivers::emit_failures(const Command& command, const std::vector<bool>& results)
+{
+  Driver::Events events;
+  for (size_t i = 0U; i < command.connections.size(); ++i) {
+    if (!results[i]) {
+      const Connection& c = command.connections[i];
+      if (command.connect) {
+        events.emplace_back(event::ConnectFailed{c.tail, c.head});
+      } else {
+        events.emplace_back(event::DisconnectFailed{c.tail, c.head});
+      }
+    }
+  }
+
+  if (!events.empty()) {
+    _emit_events(std::move(events));
+  }
+}
+
+void
+Drivers::refresh()
+{
+  _emit_events({event::Cleared{}});
+
+  start_refresh({ClientType::alsa, ClientType::jack}, {});
+}
+
+void
+Drivers::refresh(const std::vector<ClientType>& types,
+                 const Driver::EventSink&       sink)
+{
+  std::mutex                 batches_mutex;
+  std::condition_variable    batches_cond;
+  std::deque<Driver::Events> batches;
+  size_t                     running = 0U;
+
+  // Refresh every driver on its own thread, queueing what each emits
+  std::vector<std::thread> threads;
+  for (const auto type : types) {
+    if (auto* const d = driver(type)) {
+      ++running;
+      threads.emplace_back([&, type, d] {
+        {
+          // Don't run at the same time as a connection command
+          const std::lock_guard<std::mutex> driver_lock{driver_mutex(type)};
+
+          d->refresh([&](Driver::Events&& events) {
+            const std::lock_guard<std::mutex> lock{batches_mutex};
+            batches.push_back(std::move(events));
+            batches_cond.notify_one();
+          });
+        }
+
+        const std::lock_guard<std::mutex> lock{batches_mutex};
+        --running;
+        batches_cond.notify_one();
+      });
+    }
+  }
+
+  // Pass on each batch as it arrives, until every driver is finished
+  std::unique_lock<std::mutex> lock{batches_mutex};
+  while (running || !batches.empty()) {
+    batches_cond.wait(lock, [&] { return !running || !batches.empty(); });
+
+    while (!batches.empty()) {
+      Driver::Events events = std::move(batches.front());
+      batches.pop_front();
+
+      lock.unlock();
+      sink(std::move(events));
+      lock.lock();
+    }
+  }
+
+  lock.unlock();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+void
+Drivers::start_refresh(std::vector<ClientType> types, Done done)
+{
+  start_task([this, types = std::move(types), done] {
+    refresh(types, _emit_events);
+    if (done) {
+      done();
+    }
+  });
+}
+
+void
+Drivers::start_task(std::function<void()> body)
+{
+  const std::lock_guard<std::mutex> lock{_tasks_mutex};
+
+  // Clean up after any tasks that have finished
+  for (auto t = _tasks.begin(); t != _tasks.end();) {
+    if (t->finished) {
+      t->thread.join();
+      t = _tasks.erase(t);
+    } else {
+      ++t;
+    }
+  }
+
+  // The task only marks itself finished with this lock held, after this
+  Task& task  = _tasks.emplace_back();
+  task.thread = std::thread{[this, &task, body = std::move(body)] {
+    body();
+
+    const std::lock_guard<std::mutex> task_lock{_tasks_mutex};
+    task.finished = true;
+  }};
+}
+
+void
+Drivers::join_tasks()
+{
+  // Take the tasks so they can finish without this lock being held
+  std::list<Task> tasks;
+  {
+    const std::lock_guard<std::mutex> lock{_tasks_mutex};
+    tasks.splice(tasks.end(), _tasks);
+  }
+
+  for (auto& task : tasks) {
+    task.thread.join();
+  }
+}
+
+std::mutex&
+Drivers::driver_mutex(const ClientType type)
+{
+  return type == ClientType::jack ? _jack_mutex : _alsa_mutex;
+}
+
 Driver*
 Drivers::driver(const ClientType type)
 {
@@ -4,9 +4,19 @@
 #ifndef PATCHAGE_DRIVERS_HPP
 #define PATCHAGE_DRIVERS_HPP
 
+#include "Connection.hpp"
 #include "Driver.hpp"
 
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
 
 namespace patchage {
 
@@ -14,11 +24,28 @@ class AudioDriver;
 class ILog;
 enum class ClientType;
 
-/// Manager for all drivers
+/**
+   Manager for all drivers.
+
+   Connection commands may block on a server for a long time, so they are
+   queued and executed by a worker thread.  Failures are reported to the
+   event sink like any other change to the system.
+
+   Each driver has a lock that is held whenever it runs, so different drivers
+   can work concurrently.  The worker runs a command a few connections at a
+   time, holding the driver lock only for each chunk, so detaching or quitting
+   waits for at most one chunk even if the server has stopped responding.
+
+   Attaching and refreshing can also block, so the GUI starts them in the
+   background, and they emit events to the sink like everything else.
+*/
 class Drivers
 {
 public:
-  Drivers(ILog& log, Driver::EventSink emit_event);
+  /// Function called from a background thread when a task is finished
+  using Done = std::function<void()>;
+
+  Drivers(ILog& log, Driver::EventSink emit_events);
 
   Drivers(const Drivers&)            = delete;
   Drivers& operator=(const Drivers&) = delete;
@@ -28,9 +55,66 @@ public:
 
   ~Drivers();
 
-  /// Refresh all drivers and emit results to the event sink
+  /// Attach the driver for the given client type
+  void attach(ClientType type, bool launch_daemon);
+
+  /// Attach the drivers for several client types concurrently
+  void attach(const std::vector<ClientType>& types, bool launch_daemon);
+
+  /**
+     Attach the drivers for several client types in the background.
+
+     This returns immediately.  Once every driver has finished attaching, and
+     emitted any events for it, `done` is called (if it is set).
+  */
+  void start_attach(std::vector<ClientType> types,
+                    bool                    launch_daemon,
+                    Done                    done);
+
+  /// Detach the driver for the given client type and cancel its commands
+  void detach(ClientType type);
+
+  /// Clear everything and refresh all drivers in the background
   void refresh();
 
+  /**
+     Refresh the drivers for several client types concurrently.
+
+     Each driver is refreshed on its own thread, and the events it emits are
+     passed to `sink` on the calling thread as soon as they arrive, so this
+     takes about as long as the slowest driver.
+  */
+  void refresh(const std::vector<ClientType>& types,
+               const Driver::EventSink&       sink);
+
+  /**
+     Refresh the drivers for several client types in the background.
+
+     This returns immediately.  The results are emitted to the event sink,
+     then `done` is called (if it is set).
+  */
+  void start_refresh(std::vector<ClientType> types, Done done);
+
+  /**
+     Emit any events that drivers have buffered.
+
+     Drivers may gather events from system callbacks rather than emitting
+     each one as it happens, so this is called before handling events.
+  */
+  void flush_events();
+
+  /// Queue connections to be made by the driver for the given client type
+  void connect(ClientType type, std::vector<Connection> connections);
+
+  /// Queue connections to be removed by the driver for the given client type
+  void disconnect(ClientType type, std::vector<Connection> connections);
+
+  /// Queue connections to be made by the drivers that handle them
+  void connect(const std::vector<Connection>& connections);
+
+  /// Queue connections to be removed by the drivers that handle them
+  void disconnect(const std::vector<Connection>& connections);
+
   /// Return a pointer to the driver for the given client type (or null)
   Driver* driver(ClientType type);
 
@@ -41,10 +125,49 @@ public:
   const std::unique_ptr<AudioDriver>& jack() { return _jack_driver; }
 
 protected:
+  /// A command for the worker thread
+  struct Command {
+    ClientType              type;
+    bool                    connect;
+    std::vector<Connection> connections;
+  };
+
+  void push_commands(bool connect, const std::vector<Connection>& connections);
+  void push_command(Command command);
+  void run_commands();
+  bool run_chunk(const Command&     command,
+                 size_t             start,
+                 std::vector<bool>& results);
+  void emit_failures(const Command& command, const std::vector<bool>& results);
+
+  /// A thread that attaches or refreshes drivers
+  struct Task {
+    std::thread thread;
+    bool        finished{false};
+  };
+
+  void start_task(std::function<void()> body);
+  void join_tasks();
+
+  /// Return the mutex that is held while the given driver runs
+  std::mutex& driver_mutex(ClientType type);
+
   ILog&                        _log;
-  Driver::EventSink            _emit_event;
+  Driver::EventSink            _emit_events;
   std::unique_ptr<Driver>      _alsa_driver;
   std::unique_ptr<AudioDriver> _jack_driver;
+
+  std::mutex                _commands_mutex; ///< Protects commands and flags
+  std::condition_variable   _commands_cond;  ///< Signaled when commands change
+  std::deque<Command>       _commands;       ///< Commands not yet started
+  std::optional<ClientType> _running;        ///< Type of the running command
+  bool                      _cancel{false};  ///< Flag to stop running command
+  bool                      _exit{false};    ///< Flag to stop the worker
+  std::mutex                _alsa_mutex;     ///< Held while ALSA runs
+  std::mutex                _jack_mutex;     ///< Held while JACK runs
+  std::thread               _worker;         ///< Thread that runs commands
+  std::mutex                _tasks_mutex;    ///< Protects tasks
+  std::list<Task>           _tasks;          ///< Background tasks
 };
 
 } // namespace patchage
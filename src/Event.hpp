@@ -22,10 +22,25 @@ struct ClientCreated {
   ClientInfo info;
 };
 
+struct ClientChanged {
+  ClientID   id;
+  ClientInfo info;
+};
+
 struct ClientDestroyed {
   ClientID id;
 };
 
+struct ConnectFailed {
+  PortID tail;
+  PortID head;
+};
+
+struct DisconnectFailed {
+  PortID tail;
+  PortID head;
+};
+
 struct DriverAttached {
   ClientType type;
 };
@@ -39,6 +54,11 @@ struct PortCreated {
   PortInfo info;
 };
 
+struct PortChanged {
+  PortID   id;
+  PortInfo info;
+};
+
 struct PortDestroyed {
   PortID id;
 };
@@ -57,10 +77,14 @@ struct PortsDisconnected {
 
 /// An event from drivers that represents a change to the system
 using Event = std::variant<event::Cleared,
+                           event::ClientChanged,
                            event::ClientCreated,
                            event::ClientDestroyed,
+                           event::ConnectFailed,
+                           event::DisconnectFailed,
                            event::DriverAttached,
                            event::DriverDetached,
+                           event::PortChanged,
                            event::PortCreated,
                            event::PortDestroyed,
                            event::PortsConnected,
@@ -0,0 +1,265 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Graph.hpp"
+
+#include "ClientID.hpp"
+#include "ClientType.hpp"
+#include "Connection.hpp"
+#include "PortID.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace patchage {
+namespace {
+
+/// Remove an element from an array where the order doesn't matter
+template<class T>
+void
+unordered_erase(std::vector<T>& vec, const T& value)
+{
+  const auto i = std::find(vec.begin(), vec.end(), value);
+  if (i != vec.end()) {
+    *i = vec.back();
+    vec.pop_back();
+  }
+}
+
+} // namespace
+
+std::optional<Graph::Index>
+Graph::find(const PortID& id) const
+{
+  const auto i = _port_index.find(id);
+  if (i == _port_index.end()) {
+    return {};
+  }
+
+  return i->second;
+}
+
+bool
+Graph::add_port(const PortID& id)
+{
+  if (_port_index.count(id)) {
+    return false;
+  }
+
+  Index index = 0U;
+  if (_free_ports.empty()) {
+    index = static_cast<Index>(_ports.size());
+    _ports.emplace_back();
+  } else {
+    index = _free_ports.back();
+    _free_ports.pop_back();
+  }
+
+  const auto client = id.client();
+
+  _ports[index] = Port{id, client, {}, {}};
+  _port_index.emplace(id, index);
+  _client_ports[client].push_back(index);
+  return true;
+}
+
+void
+Graph::remove_port(const PortID& id)
+{
+  const auto index = find(id);
+  if (!index) {
+    return;
+  }
+
+  // Remove every connection, the adjacency lists shrink as they go
+  Port& port = *_ports[*index];
+  while (!port.heads.empty()) {
+    remove_edge(*index, port.heads.back());
+  }
+
+  while (!port.tails.empty()) {
+    remove_edge(port.tails.back(), *index);
+  }
+
+  // Remove the port from its client
+  const auto c = _client_ports.find(port.client);
+  if (c != _client_ports.end()) {
+    unordered_erase(c->second, *index);
+    if (c->second.empty()) {
+      _client_ports.erase(c);
+    }
+  }
+
+  _port_index.erase(id);
+  _ports[*index] = std::nullopt;
+  _free_ports.push_back(*index);
+}
+
+void
+Graph::remove_client(const ClientID& id)
+{
+  const auto c = _client_ports.find(id);
+  if (c == _client_ports.end()) {
+    return;
+  }
+
+  for (const Index index : std::vector<Index>{c->second}) {
+    remove_port(_ports[index]->id);
+  }
+}
+
+void
+Graph::remove_ports(const ClientType type)
+{
+  std::vector<PortID> ids;
+  for (const auto& p : _port_index) {
+    if (p.first.type() == type) {
+      ids.push_back(p.first);
+    }
+  }
+
+  for (const auto& id : ids) {
+    remove_port(id);
+  }
+}
+
+bool
+Graph::connect(const PortID& tail, const PortID& head)
+{
+  const auto t = find(tail);
+  const auto h = find(head);
+  if (!t || !h || !_edges.insert(edge_key(*t, *h)).second) {
+    return false;
+  }
+
+  _ports[*t]->heads.push_back(*h);
+  _ports[*h]->tails.push_back(*t);
+  return true;
+}
+
+bool
+Graph::disconnect(const PortID& tail, const PortID& head)
+{
+  const auto t = find(tail);
+  const auto h = find(head);
+  if (!t || !h || !_edges.count(edge_key(*t, *h))) {
+    return false;
+  }
+
+  remove_edge(*t, *h);
+  return true;
+}
+
+void
+Graph::remove_edge(const Index tail, const Index head)
+{
+  _edges.erase(edge_key(tail, head));
+  unordered_erase(_ports[tail]->heads, head);
+  unordered_erase(_ports[head]->tails, tail);
+}
+
+void
+Graph::clear()
+{
+  _ports.clear();
+  _free_ports.clear();
+  _port_index.clear();
+  _client_ports.clear();
+  _edges.clear();
+}
+
+bool
+Graph::contains(const PortID& id) const
+{
+  return _port_index.count(id);
+}
+
+bool
+Graph::connected(const PortID& tail, const PortID& head) const
+{
+  const auto t = find(tail);
+  const auto h = find(head);
+
+  return t && h && _edges.count(edge_key(*t, *h));
+}
+
+std::vector<PortID>
+Graph::client_ports(const ClientID& id) const
+{
+  std::vector<PortID> result;
+
+  const auto c = _client_ports.find(id);
+  if (c != _client_ports.end()) {
+    result.reserve(c->second.size());
+    for (const Index index : c->second) {
+      result.push_back(_ports[index]->id);
+    }
+  }
+
+  return result;
+}
+
+std::vector<Connection>
+Graph::connections() const
+{
+  std::vector<Connection> result;
+  result.reserve(_edges.size());
+  for (const auto& port : _ports) {
+    if (port) {
+      for (const Index head : port->heads) {
+        result.push_back(Connection{port->id, _ports[head]->id});
+      }
+    }
+  }
+
+  return result;
+}
+
+std::vector<Connection>
+Graph::connections_on(const PortID& id) const
+{
+  std::vector<Connection> result;
+  if (const auto index = find(id)) {
+    const Port& port = *_ports[*index];
+    for (const Index head : port.heads) {
+      result.push_back(Connection{id, _ports[head]->id});
+    }
+
+    for (const Index tail : port.tails) {
+      result.push_back(Connection{_ports[tail]->id, id});
+    }
+  }
+
+  return result;
+}
+
+std::vector<Connection>
+Graph::connections_on(const ClientID& id) const
+{
+  std::vector<Connection> result;
+
+  const auto c = _client_ports.find(id);
+  if (c == _client_ports.end()) {
+    return result;
+  }
+
+  for (const Index index : c->second) {
+    const Port& port = *_ports[index];
+    for (const Index head : port.heads) {
+      result.push_back(Connection{port.id, _ports[head]->id});
+    }
+
+    // Connections within the client were already added from their tail
+    for (const Index tail : port.tails) {
+      if (!(_ports[tail]->client == id)) {
+        result.push_back(Connection{_ports[tail]->id, port.id});
+      }
+    }
+  }
+
+  return result;
+}
+
+} // namespace patchage
@@ -0,0 +1,116 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PATCHAGE_GRAPH_HPP
+#define PATCHAGE_GRAPH_HPP
+
+#include "ClientID.hpp"
+#include "ClientType.hpp"
+#include "Connection.hpp"
+#include "PortID.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace patchage {
+
+/**
+   The ports and connections of the system.
+
+   This is the model of the graph that the canvas shows, kept up to date from
+   driver events, so connectivity can be queried without the GUI.  Ports are
+   stored in a dense array and refer to each other by index, so finding the
+   neighbours of a port takes time proportional to its degree, and checking
+   if two ports are connected is a single hash lookup.
+*/
+class Graph
+{
+public:
+  /// Add a port, return false if it is already present
+  bool add_port(const PortID& id);
+
+  /// Remove a port and all of its connections
+  void remove_port(const PortID& id);
+
+  /// Remove all ports of a client and all of their connections
+  void remove_client(const ClientID& id);
+
+  /// Remove all ports of the given type and all of their connections
+  void remove_ports(ClientType type);
+
+  /// Add a connection, return false if a port is unknown or already connected
+  bool connect(const PortID& tail, const PortID& head);
+
+  /// Remove a connection, return false if it is not present
+  bool disconnect(const PortID& tail, const PortID& head);
+
+  /// Remove all ports and connections
+  void clear();
+
+  /// Return true if the graph has the given port
+  bool contains(const PortID& id) const;
+
+  /// Return true if the given ports are connected
+  bool connected(const PortID& tail, const PortID& head) const;
+
+  /// Return the ports of a client
+  std::vector<PortID> client_ports(const ClientID& id) const;
+
+  /// Return all connections
+  std::vector<Connection> connections() const;
+
+  /// Call `visitor` with the tail and head of every connection
+  template<class Visitor>
+  void each_connection(Visitor visitor) const
+  {
+    for (const auto& port : _ports) {
+      if (port) {
+        for (const Index head : port->heads) {
+          visitor(port->id, _ports[head]->id);
+        }
+      }
+    }
+  }
+
+  /// Return all connections to or from a port
+  std::vector<Connection> connections_on(const PortID& id) const;
+
+  /// Return all connections to or from the ports of a client
+  std::vector<Connection> connections_on(const ClientID& id) const;
+
+  size_t num_ports() const { return _port_index.size(); }
+  size_t num_connections() const { return _edges.size(); }
+
+private:
+  using Index = uint32_t;
+
+  struct Port {
+    PortID             id;
+    ClientID           client;
+    std::vector<Index> heads; ///< Inputs that this port is connected to
+    std::vector<Index> tails; ///< Outputs that are connected to this port
+  };
+
+  static uint64_t edge_key(const Index tail, const Index head)
+  {
+    return (uint64_t{tail} << 32U) | head;
+  }
+
+  std::optional<Index> find(const PortID& id) const;
+
+  void remove_edge(Index tail, Index head);
+
+  std::vector<std::optional<Port>>                 _ports;
+  std::vector<Index>                               _free_ports;
+  std::unordered_map<PortID, Index>                _port_index;
+  std::unordered_map<ClientID, std::vector<Index>> _client_ports;
+  std::unordered_set<uint64_t>                     _edges;
+};
+
+} // namespace patchage
+
+#endif // PATCHAGE_GRAPH_HPP
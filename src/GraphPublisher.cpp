@@ -0,0 +1,192 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "GraphPublisher.hpp"
+
+#include "ILog.hpp"
+#include "encode_event.hpp"
+#include "warnings.hpp"
+
+PATCHAGE_DISABLE_FMT_WARNINGS
+#include <fmt/core.h>
+PATCHAGE_RESTORE_WARNINGS
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+
+namespace patchage {
+namespace {
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "Shared sequence counter must be lock-free");
+
+/// Initial size of the data area, which is enough for a typical studio
+constexpr size_t initial_capacity = 1U << 16U;
+
+/// Return true if a shared memory name refers to the file with the given status
+bool
+is_named(const std::string& name, const struct stat& status)
+{
+  const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat named{};
+  const bool  same = !fstat(fd, &named) && named.st_dev == status.st_dev &&
+                    named.st_ino == status.st_ino;
+
+  close(fd);
+  return same;
+}
+
+} // namespace
+
+GraphPublisher::GraphPublisher(ILog& log)
+  : _log{log}
+{}
+
+GraphPublisher::~GraphPublisher()
+{
+  if (_header) {
+    munmap(_header, sizeof(SharedGraphHeader) + _capacity);
+  }
+
+  if (_fd >= 0) {
+    // Remove the name only if it hasn't been taken over by another instance
+    struct stat status{};
+    if (!fstat(_fd, &status) && is_named(_name, status)) {
+      shm_unlink(_name.c_str());
+    }
+
+    close(_fd);
+  }
+}
+
+std::string
+GraphPublisher::default_name()
+{
+  return fmt::format("/patchage-{}", getuid());
+}
+
+bool
+GraphPublisher::open(const std::string& name)
+{
+  // Open the segment, which may have been left behind by a crashed instance
+  const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+  if (fd < 0) {
+    _log.error(fmt::format(
+      u8"Failed to create shared memory “{}” ({})", name, strerror(errno)));
+    return false;
+  }
+
+  // Only use a segment that belongs to this user alone
+  struct stat status{};
+  if (fstat(fd, &status) || status.st_uid != getuid() ||
+      (status.st_mode & (S_IRWXG | S_IRWXO))) {
+    _log.error(
+      fmt::format(u8"Shared memory “{}” is not private to this user", name));
+    close(fd);
+    return false;
+  }
+
+  // Take it over, but not from another instance that is still publishing
+  if (flock(fd, LOCK_EX | LOCK_NB)) {
+    _log.warning(fmt::format(u8"Shared memory “{}” is already in use", name));
+    close(fd);
+    return false;
+  }
+
+  // Start again if the previous owner removed it before we got the lock
+  if (!is_named(name, status)) {
+    close(fd);
+    return open(name);
+  }
+
+  _fd   = fd;
+  _name = name;
+  if (!map(initial_capacity)) {
+    return false;
+  }
+
+  memcpy(_header->magic, "PATCHAGE", sizeof(_header->magic));
+  _header->format  = 1U;
+  _header->padding = 0U;
+  new (&_header->sequence) std::atomic<uint64_t>{0U};
+  _header->size = 0U;
+  return true;
+}
+
+bool
+GraphPublisher::map(const size_t capacity)
+{
+  const size_t size = sizeof(SharedGraphHeader) + capacity;
+  if (ftruncate(_fd, static_cast<off_t>(size))) {
+    _log.error(fmt::format(u8"Failed to resize shared memory “{}” ({})",
+                           _name,
+                           strerror(errno)));
+    return false;
+  }
+
+  void* const data =
+    mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+  if (data == MAP_FAILED) {
+    _log.error(fmt::format(
+      u8"Failed to map shared memory “{}” ({})", _name, strerror(errno)));
+    return false;
+  }
+
+  if (_header) {
+    munmap(_header, sizeof(SharedGraphHeader) + _capacity);
+  }
+
+  _header           = static_cast<SharedGraphHeader*>(data);
+  _header->capacity = capacity;
+  _capacity         = capacity;
+  return true;
+}
+
+void
+GraphPublisher::publish(const Metadata& metadata, const Graph& graph)
+{
+  if (!_header) {
+    return;
+  }
+
+  _buffer.clear();
+  encode_snapshot(_buffer, metadata, graph);
+
+  // Make the sequence odd so readers know the data is changing
+  const uint64_t sequence = _header->sequence.load(std::memory_order_relaxed);
+  _header->sequence.store(sequence + 1U, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  // Grow the segment if necessary, readers will map it again
+  size_t capacity = _capacity;
+  while (capacity < _buffer.size()) {
+    capacity *= 2U;
+  }
+
+  if (capacity == _capacity || map(capacity)) {
+    auto* const data = reinterpret_cast<char*>(_header + 1);
+    memcpy(data, _buffer.data(), _buffer.size());
+    _header->size = _buffer.size();
+  } else {
+    _header->size = 0U;
+  }
+
+  _header->sequence.store(sequence + 2U, std::memory_order_release);
+}
+
+} // namespace patchage
@@ -0,0 +1,79 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PATCHAGE_GRAPHPUBLISHER_HPP
+#define PATCHAGE_GRAPHPUBLISHER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace patchage {
+
+class Graph;
+class ILog;
+class Metadata;
+
+/**
+   The header at the start of the shared memory graph snapshot.
+
+   The data after the header is a sequence of frames as written by
+   encode_snapshot().  Readers copy it while `sequence` is even and unchanged
+   before and after the copy, and retry otherwise.  If `capacity` is larger
+   than the mapped data area, the segment has grown and must be mapped again.
+*/
+struct SharedGraphHeader {
+  char                  magic[8]; ///< "PATCHAGE"
+  uint32_t              format;   ///< Format version, currently 1
+  uint32_t              padding;  ///< Unused, zero
+  std::atomic<uint64_t> sequence; ///< Odd while writing, twice the version
+  uint64_t              capacity; ///< Size of the data area in bytes
+  uint64_t              size;     ///< Size of the snapshot data in bytes
+};
+
+/**
+   Publisher of the current graph in a POSIX shared memory segment.
+
+   This lets tools on the same host read the graph without any round trip.
+   Readers never block the publisher, which only ever writes.  The publisher
+   holds an exclusive flock() on the segment while it is open, so another
+   instance won't take it over, and a segment left behind by an instance that
+   crashed is reused.
+*/
+class GraphPublisher
+{
+public:
+  explicit GraphPublisher(ILog& log);
+
+  GraphPublisher(const GraphPublisher&)            = delete;
+  GraphPublisher& operator=(const GraphPublisher&) = delete;
+
+  GraphPublisher(GraphPublisher&&)            = delete;
+  GraphPublisher& operator=(GraphPublisher&&) = delete;
+
+  ~GraphPublisher();
+
+  /// Return the default segment name for the current user
+  static std::string default_name();
+
+  /// Create the shared memory segment, return false on error
+  bool open(const std::string& name);
+
+  /// Write the current graph to the segment
+  void publish(const Metadata& metadata, const Graph& graph);
+
+private:
+  bool map(size_t capacity);
+
+  ILog&              _log;
+  std::string        _name;
+  std::string        _buffer;
+  int                _fd{-1};
+  SharedGraphHeader* _header{nullptr};
+  size_t             _capacity{0U};
+};
+
+} // namespace patchage
+
+#endif // PATCHAGE_GRAPHPUBLISHER_HPP
@@ -5,9 +5,11 @@
 #include "AudioDriver.hpp"
 #include "ClientID.hpp"
 #include "ClientType.hpp"
+#include "Connection.hpp"
 #include "Driver.hpp"
 #include "Event.hpp"
 #include "ILog.hpp"
+#include "PortActivity.hpp"
 #include "PortID.hpp"
 #include "PortInfo.hpp"
 #include "PortNames.hpp"
@@ -25,17 +27,21 @@ PATCHAGE_RESTORE_WARNINGS
 #include <dbus/dbus-shared.h>
 #include <dbus/dbus.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdarg>
 #include <cstdint>
 #include <cstring>
 #include <functional>
+#include <map>
 #include <memory>
 #include <optional>
 #include <stdexcept>
 #include <string>
 #include <utility>
 #include <variant>
+#include <vector>
 
 #define JACKDBUS_SERVICE "org.jackaudio.service"
 #define JACKDBUS_OBJECT "/org/jackaudio/Controller"
@@ -59,7 +65,7 @@ enum JackDBusPortType {
 class JackDriver : public AudioDriver
 {
 public:
-  explicit JackDriver(ILog& log, EventSink emit_event);
+  explicit JackDriver(ILog& log, EventSink emit_events);
 
   JackDriver(const JackDriver&)            = delete;
   JackDriver& operator=(const JackDriver&) = delete;
@@ -74,8 +80,13 @@ public:
   void detach() override;
   bool is_attached() const override;
   void refresh(const EventSink& sink) override;
-  bool connect(const PortID& tail_id, const PortID& head_id) override;
-  bool disconnect(const PortID& tail_id, const PortID& head_id) override;
+  std::vector<bool>
+  connect_many(const std::vector<Connection>& connections) override;
+  std::vector<bool>
+  disconnect_many(const std::vector<Connection>& connections) override;
+  bool monitor(const PortID& id) override;
+  void unmonitor(const PortID& id) override;
+  std::optional<PortActivity> activity(const PortID& id) override;
 
   // AudioDriver interface
   uint32_t xruns() override;
@@ -85,6 +96,28 @@ public:
   uint32_t sample_rate() override;
 
 private:
+  /// A port in the last known graph
+  struct GraphPort {
+    dbus_uint64_t client_id;
+    std::string   name;
+    dbus_uint32_t flags;
+    dbus_uint32_t type;
+  };
+
+  /// A connection in the last known graph, between two port ids
+  struct GraphConnection {
+    dbus_uint64_t tail_id;
+    dbus_uint64_t head_id;
+  };
+
+  /// The last known graph, all keyed by jackdbus id
+  struct Graph {
+    dbus_uint64_t                            version{};
+    std::map<dbus_uint64_t, std::string>     clients;
+    std::map<dbus_uint64_t, GraphPort>       ports;
+    std::map<dbus_uint64_t, GraphConnection> connections;
+  };
+
   PortType patchage_port_type(dbus_uint32_t dbus_port_type) const;
 
   PortInfo port_info(const std::string& port_name,
@@ -101,8 +134,46 @@ private:
             int           in_type,
             ...);
 
+  /// Handler for the reply to an asynchronous call
+  using ReplyHandler = void (JackDriver::*)(DBusMessage* reply);
+
+  /// An asynchronous call waiting for its reply
+  struct PendingCall {
+    JackDriver*  driver;
+    const char*  method;
+    ReplyHandler handler;
+  };
+
+  bool call_async(const char*  method,
+                  ReplyHandler handler,
+                  int          in_type,
+                  ...);
+
+  void query(const char* method, ReplyHandler handler);
+
+  std::vector<bool> call_many(const char*                    method,
+                              const std::vector<Connection>& connections);
+
+  void cancel_calls();
+
+  static void on_reply(DBusPendingCall* pending, void* data);
+
+  void on_get_xruns(DBusMessage* reply);
+  void on_get_buffer_size(DBusMessage* reply);
+  void on_set_buffer_size(DBusMessage* reply);
+  void on_get_sample_rate(DBusMessage* reply);
+
   void update_attached();
 
+  bool get_graph(dbus_uint64_t known_version, Graph& graph);
+
+  PortID graph_port_id(const Graph& graph, dbus_uint64_t port_id) const;
+
+  void emit_graph(const Graph& graph, const EventSink& sink) const;
+  void emit_graph_changes(const Graph& old_graph, const Graph& new_graph);
+
+  bool apply_version(dbus_uint64_t new_graph_version);
+
   bool is_started();
 
   void start_server();
@@ -121,22 +192,34 @@ private:
   DBusError       _dbus_error;
   DBusConnection* _dbus_connection{};
 
-  mutable bool _server_responding{};
-  bool         _server_started{};
+  std::atomic<bool> _server_responding{}; ///< Also read by the worker
+  bool              _server_started{};
+
+  Graph _graph;
+  bool  _graph_valid{};
 
-  dbus_uint64_t _graph_version{};
+  std::map<DBusPendingCall*, const char*> _pending_calls;
+
+  // Latest server state, updated when replies arrive
+  uint32_t _xruns{};
+  uint32_t _buffer_size{};
+  uint32_t _sample_rate{};
 };
 
-JackDriver::JackDriver(ILog& log, EventSink emit_event)
-  : AudioDriver{std::move(emit_event)}
+JackDriver::JackDriver(ILog& log, EventSink emit_events)
+  : AudioDriver{std::move(emit_events)}
   , _log(log)
   , _dbus_error()
 {
+  // Connections are made by the Drivers worker thread
+  dbus_threads_init_default();
   dbus_error_init(&_dbus_error);
 }
 
 JackDriver::~JackDriver()
 {
+  cancel_calls();
+
   if (_dbus_connection) {
     dbus_connection_flush(_dbus_connection);
   }
@@ -154,18 +237,18 @@ JackDriver::update_attached()
 
   if (!_server_responding) {
     if (was_attached) {
-      _emit_event(event::DriverDetached{ClientType::jack});
+      emit_event(event::DriverDetached{ClientType::jack});
     }
     return;
   }
 
   if (_server_started && !was_attached) {
-    _emit_event(event::DriverAttached{ClientType::jack});
+    emit_event(event::DriverAttached{ClientType::jack});
     return;
   }
 
   if (!_server_started && was_attached) {
-    _emit_event(event::DriverDetached{ClientType::jack});
+    emit_event(event::DriverDetached{ClientType::jack});
     return;
   }
 }
@@ -186,9 +269,13 @@ JackDriver::on_jack_disappeared()
   // jackdbus
 
   _server_responding = false;
+  _graph_valid       = false;
+  _xruns             = 0U;
+  _buffer_size       = 0U;
+  _sample_rate       = 0U;
 
   if (_server_started) {
-    _emit_event(event::DriverDetached{ClientType::jack});
+    emit_event(event::DriverDetached{ClientType::jack});
   }
 
   _server_started = false;
@@ -273,12 +360,16 @@ JackDriver::dbus_message_hook(DBusConnection* /*connection*/,
 
     if (!me->_server_started) {
       me->_server_started = true;
-      me->_emit_event(event::DriverAttached{ClientType::jack});
+      me->emit_event(event::DriverAttached{ClientType::jack});
     }
 
-    me->_emit_event(
-      event::PortCreated{PortID::jack(client_name, port_name),
-                         me->port_info(port_name, port_type, port_flags)});
+    if (me->apply_version(new_graph_version)) {
+      me->_graph.clients.emplace(client_id, client_name);
+      me->_graph.ports[port_id] = {client_id, port_name, port_flags, port_type};
+      me->emit_event(
+        event::PortCreated{PortID::jack(client_name, port_name),
+                           me->port_info(port_name, port_type, port_flags)});
+    }
 
     return DBUS_HANDLER_RESULT_HANDLED;
   }
@@ -307,10 +398,32 @@ JackDriver::dbus_message_hook(DBusConnection* /*connection*/,
 
     if (!me->_server_started) {
       me->_server_started = true;
-      me->_emit_event(event::DriverAttached{ClientType::jack});
+      me->emit_event(event::DriverAttached{ClientType::jack});
     }
 
-    me->_emit_event(event::PortDestroyed{PortID::jack(client_name, port_name)});
+    if (me->apply_version(new_graph_version)) {
+      auto& graph = me->_graph;
+      graph.ports.erase(port_id);
+      for (auto c = graph.connections.begin(); c != graph.connections.end();) {
+        if (c->second.tail_id == port_id || c->second.head_id == port_id) {
+          c = graph.connections.erase(c);
+        } else {
+          ++c;
+        }
+      }
+
+      // Forget the client when its last port is gone
+      if (std::none_of(graph.ports.begin(),
+                       graph.ports.end(),
+                       [client_id](const auto& p) {
+                         return p.second.client_id == client_id;
+                       })) {
+        graph.clients.erase(client_id);
+      }
+
+      me->emit_event(
+        event::PortDestroyed{PortID::jack(client_name, port_name)});
+    }
 
     return DBUS_HANDLER_RESULT_HANDLED;
   }
@@ -349,12 +462,18 @@ JackDriver::dbus_message_hook(DBusConnection* /*connection*/,
 
     if (!me->_server_started) {
       me->_server_started = true;
-      me->_emit_event(event::DriverAttached{ClientType::jack});
+      me->emit_event(event::DriverAttached{ClientType::jack});
     }
 
-    me->_emit_event(
-      event::PortsConnected{PortID::jack(client_name, port_name),
-                            PortID::jack(client2_name, port2_name)});
+    if (me->apply_version(new_graph_version)) {
+      if (me->_graph.ports.count(port_id) && me->_graph.ports.count(port2_id)) {
+        me->_graph.connections[connection_id] = {port_id, port2_id};
+      }
+
+      me->emit_event(
+        event::PortsConnected{PortID::jack(client_name, port_name),
+                              PortID::jack(client2_name, port2_name)});
+    }
 
     return DBUS_HANDLER_RESULT_HANDLED;
   }
@@ -393,12 +512,15 @@ JackDriver::dbus_message_hook(DBusConnection* /*connection*/,
 
     if (!me->_server_started) {
       me->_server_started = true;
-      me->_emit_event(event::DriverAttached{ClientType::jack});
+      me->emit_event(event::DriverAttached{ClientType::jack});
     }
 
-    me->_emit_event(
-      event::PortsDisconnected{PortID::jack(client_name, port_name),
-                               PortID::jack(client2_name, port2_name)});
+    if (me->apply_version(new_graph_version)) {
+      me->_graph.connections.erase(connection_id);
+      me->emit_event(
+        event::PortsDisconnected{PortID::jack(client_name, port_name),
+                                 PortID::jack(client2_name, port2_name)});
+    }
 
     return DBUS_HANDLER_RESULT_HANDLED;
   }
@@ -452,6 +574,245 @@ JackDriver::call(bool          response_expected,
   return reply_ptr;
 }
 
+bool
+JackDriver::call_async(const char* const  method,
+                       const ReplyHandler handler,
+                       int                in_type,
+                       ...)
+{
+  if (!_dbus_connection) {
+    return false;
+  }
+
+  DBusMessage* const request = dbus_message_new_method_call(
+    JACKDBUS_SERVICE, JACKDBUS_OBJECT, JACKDBUS_IFACE_CONTROL, method);
+  if (!request) {
+    throw std::runtime_error("dbus_message_new_method_call() returned 0");
+  }
+
+  va_list ap;
+  va_start(ap, in_type);
+  dbus_message_append_args_valist(request, in_type, ap);
+  va_end(ap);
+
+  // Send the message, the reply is dispatched later by the main loop
+  DBusPendingCall* pending = nullptr;
+  if (!dbus_connection_send_with_reply(
+        _dbus_connection, request, &pending, default_timeout) ||
+      !pending) {
+    dbus_message_unref(request);
+    error_msg(fmt::format("Failed to call method {}", method));
+    return false;
+  }
+
+  dbus_message_unref(request);
+
+  _pending_calls.emplace(pending, method);
+  dbus_pending_call_set_notify(
+    pending,
+    on_reply,
+    new PendingCall{this, method, handler},
+    [](void* data) { delete static_cast<PendingCall*>(data); });
+
+  return true;
+}
+
+void
+JackDriver::query(const char* const method, const ReplyHandler handler)
+{
+  if (_server_responding && !_server_started) {
+    return;
+  }
+
+  // Only have one query for each value in flight at once
+  for (const auto& p : _pending_calls) {
+    if (!strcmp(p.second, method)) {
+      return;
+    }
+  }
+
+  call_async(method, handler, DBUS_TYPE_INVALID);
+}
+
+std::vector<bool>
+JackDriver::call_many(const char* const              method,
+                      const std::vector<Connection>& connections)
+{
+  std::vector<bool> results(connections.size(), false);
+  if (!_dbus_connection) {
+    return results;
+  }
+
+  // Send every request before waiting so the server can handle them together
+  std::vector<DBusPendingCall*> pending(connections.size(), nullptr);
+  for (size_t i = 0U; i < connections.size(); ++i) {
+    const auto        tail_names       = PortNames(connections[i].tail);
+    const auto        head_names       = PortNames(connections[i].head);
+    const char* const tail_client_name = tail_names.client().c_str();
+    const char* const tail_port_name   = tail_names.port().c_str();
+    const char* const head_client_name = head_names.client().c_str();
+    const char* const head_port_name   = head_names.port().c_str();
+
+    DBusMessage* const request = dbus_message_new_method_call(
+      JACKDBUS_SERVICE, JACKDBUS_OBJECT, JACKDBUS_IFACE_PATCHBAY, method);
+    if (!request) {
+      throw std::runtime_error("dbus_message_new_method_call() returned 0");
+    }
+
+    dbus_message_append_args(request,
+                             DBUS_TYPE_STRING,
+                             &tail_client_name,
+                             DBUS_TYPE_STRING,
+                             &tail_port_name,
+                             DBUS_TYPE_STRING,
+                             &head_client_name,
+                             DBUS_TYPE_STRING,
+                             &head_port_name,
+                             DBUS_TYPE_INVALID);
+
+    if (!dbus_connection_send_with_reply(
+          _dbus_connection, request, &pending[i], default_timeout)) {
+      pending[i] = nullptr;
+    }
+
+    dbus_message_unref(request);
+  }
+
+  // Wait for all the replies, with an error of our own since this is called
+  // from the worker thread while the main thread handles other replies
+  DBusError   dbus_error;
+  std::string error;
+  dbus_error_init(&dbus_error);
+  for (size_t i = 0U; i < connections.size(); ++i) {
+    DBusMessage* reply = nullptr;
+    if (pending[i]) {
+      dbus_pending_call_block(pending[i]);
+      reply = dbus_pending_call_steal_reply(pending[i]);
+      dbus_pending_call_unref(pending[i]);
+    }
+
+    if (!reply) {
+      error = error.empty() ? "no reply from server" : error;
+    } else if (dbus_set_error_from_message(&dbus_error, reply)) {
+      error = error.empty() ? dbus_error.message : error;
+      dbus_error_free(&dbus_error);
+    } else {
+      results[i] = true;
+    }
+
+    if (reply) {
+      dbus_message_unref(reply);
+    }
+  }
+
+  if (!error.empty()) {
+    error_msg(failure_message(
+      fmt::format("{}() failed for", method), connections, results, error));
+  }
+
+  return results;
+}
+
+void
+JackDriver::cancel_calls()
+{
+  for (const auto& p : _pending_calls) {
+    dbus_pending_call_cancel(p.first);
+    dbus_pending_call_unref(p.first);
+  }
+
+  _pending_calls.clear();
+}
+
+void
+JackDriver::on_reply(DBusPendingCall* const pending, void* const data)
+{
+  const auto* const call = static_cast<const PendingCall*>(data);
+  JackDriver* const me   = call->driver;
+
+  me->_pending_calls.erase(pending);
+
+  DBusMessage* const reply = dbus_pending_call_steal_reply(pending);
+  dbus_pending_call_unref(pending);
+  if (!reply) {
+    return;
+  }
+
+  if (dbus_set_error_from_message(&me->_dbus_error, reply)) {
+    me->error_msg(fmt::format("Error from server when calling method {} ({})",
+                              call->method,
+                              me->_dbus_error.message));
+
+    if (dbus_error_has_name(&me->_dbus_error, DBUS_ERROR_NO_REPLY)) {
+      me->_server_responding = false;
+    }
+
+    dbus_error_free(&me->_dbus_error);
+  } else {
+    me->_server_responding = true;
+    if (call->handler) {
+      (me->*call->handler)(reply);
+    }
+  }
+
+  dbus_message_unref(reply);
+}
+
+void
+JackDriver::on_get_xruns(DBusMessage* const reply)
+{
+  dbus_uint32_t xruns = 0U;
+  if (!dbus_message_get_args(
+        reply, &_dbus_error, DBUS_TYPE_UINT32, &xruns, DBUS_TYPE_INVALID)) {
+    dbus_error_free(&_dbus_error);
+    error_msg("Decoding reply of GetXruns failed");
+    return;
+  }
+
+  _xruns = xruns;
+}
+
+void
+JackDriver::on_get_buffer_size(DBusMessage* const reply)
+{
+  dbus_uint32_t buffer_size = 0U;
+  if (!dbus_message_get_args(reply,
+                             &_dbus_error,
+                             DBUS_TYPE_UINT32,
+                             &buffer_size,
+                             DBUS_TYPE_INVALID)) {
+    dbus_error_free(&_dbus_error);
+    error_msg("Decoding reply of GetBufferSize failed");
+    return;
+  }
+
+  _buffer_size = buffer_size;
+}
+
+void
+JackDriver::on_set_buffer_size(DBusMessage*)
+{
+  // Get the actual buffer size, which may differ from what was requested
+  query("GetBufferSize", &JackDriver::on_get_buffer_size);
+}
+
+void
+JackDriver::on_get_sample_rate(DBusMessage* const reply)
+{
+  dbus_uint32_t sample_rate = 0U;
+  if (!dbus_message_get_args(reply,
+                             &_dbus_error,
+                             DBUS_TYPE_UINT32,
+                             &sample_rate,
+                             DBUS_TYPE_INVALID)) {
+    dbus_error_free(&_dbus_error);
+    error_msg("Decoding reply of GetSampleRate failed");
+    return;
+  }
+
+  _sample_rate = sample_rate;
+}
+
 bool
 JackDriver::is_started()
 {
@@ -514,7 +875,7 @@ JackDriver::stop_server()
   }
 
   dbus_message_unref(reply_ptr);
-  _emit_event(event::DriverDetached{ClientType::jack});
+  emit_event(event::DriverDetached{ClientType::jack});
 }
 
 void
@@ -579,12 +940,12 @@ JackDriver::is_attached() const
   return _dbus_connection && _server_responding;
 }
 
-void
-JackDriver::refresh(const EventSink& sink)
+bool
+JackDriver::get_graph(const dbus_uint64_t known_version, Graph& graph)
 {
   DBusMessage*    reply_ptr              = nullptr;
   DBusMessageIter iter                   = {};
-  dbus_uint64_t   version                = 0U;
+  dbus_uint64_t   version                = known_version;
   const char*     reply_signature        = nullptr;
   DBusMessageIter clients_array_iter     = {};
   DBusMessageIter client_struct_iter     = {};
@@ -612,7 +973,7 @@ JackDriver::refresh(const EventSink& sink)
             &version,
             DBUS_TYPE_INVALID)) {
     error_msg("GetGraph() failed");
-    return;
+    return false;
   }
 
   reply_signature = dbus_message_get_signature(reply_ptr);
@@ -621,7 +982,7 @@ JackDriver::refresh(const EventSink& sink)
     error_msg(std::string{"GetGraph() reply signature mismatch. "} +
               reply_signature);
     dbus_message_unref(reply_ptr);
-    return;
+    return false;
   }
 
   dbus_message_iter_init(reply_ptr, &iter);
@@ -629,9 +990,9 @@ JackDriver::refresh(const EventSink& sink)
   dbus_message_iter_get_basic(&iter, &version);
   dbus_message_iter_next(&iter);
 
-  _graph_version = version;
+  graph.version = version;
 
-  // Emit all clients and ports
+  // Read all clients and ports (empty if the version is already known)
   for (dbus_message_iter_recurse(&iter, &clients_array_iter);
        dbus_message_iter_get_arg_type(&clients_array_iter) != DBUS_TYPE_INVALID;
        dbus_message_iter_next(&clients_array_iter)) {
@@ -643,8 +1004,7 @@ JackDriver::refresh(const EventSink& sink)
     dbus_message_iter_get_basic(&client_struct_iter, &client_name);
     dbus_message_iter_next(&client_struct_iter);
 
-    // TODO: Pretty name?
-    sink({event::ClientCreated{ClientID::jack(client_name), {client_name}}});
+    graph.clients.emplace(client_id, client_name);
 
     for (dbus_message_iter_recurse(&client_struct_iter, &ports_array_iter);
          dbus_message_iter_get_arg_type(&ports_array_iter) != DBUS_TYPE_INVALID;
@@ -663,8 +1023,8 @@ JackDriver::refresh(const EventSink& sink)
       dbus_message_iter_get_basic(&port_struct_iter, &port_type);
       dbus_message_iter_next(&port_struct_iter);
 
-      sink({event::PortCreated{PortID::jack(client_name, port_name),
-                               port_info(port_name, port_type, port_flags)}});
+      graph.ports.emplace(
+        port_id, GraphPort{client_id, port_name, port_flags, port_type});
     }
 
     dbus_message_iter_next(&client_struct_iter);
@@ -672,7 +1032,7 @@ JackDriver::refresh(const EventSink& sink)
 
   dbus_message_iter_next(&iter);
 
-  // Emit all connections
+  // Read all connections
   for (dbus_message_iter_recurse(&iter, &connections_array_iter);
        dbus_message_iter_get_arg_type(&connections_array_iter) !=
        DBUS_TYPE_INVALID;
@@ -706,205 +1066,228 @@ JackDriver::refresh(const EventSink& sink)
     dbus_message_iter_get_basic(&connection_struct_iter, &connection_id);
     dbus_message_iter_next(&connection_struct_iter);
 
-    sink({event::PortsConnected{PortID::jack(client_name, port_name),
-                                PortID::jack(client2_name, port2_name)}});
+    graph.connections.emplace(connection_id,
+                              GraphConnection{port_id, port2_id});
   }
+
+  dbus_message_unref(reply_ptr);
+  return true;
 }
 
-bool
-JackDriver::connect(const PortID& tail_id, const PortID& head_id)
+PortID
+JackDriver::graph_port_id(const Graph& graph, const dbus_uint64_t port_id) const
 {
-  const auto        tail_names       = PortNames(tail_id);
-  const auto        head_names       = PortNames(head_id);
-  const char* const tail_client_name = tail_names.client().c_str();
-  const char* const tail_port_name   = tail_names.port().c_str();
-  const char* const head_client_name = head_names.client().c_str();
-  const char* const head_port_name   = head_names.port().c_str();
-
-  DBusMessage* reply_ptr = nullptr;
-
-  if (!call(true,
-            JACKDBUS_IFACE_PATCHBAY,
-            "ConnectPortsByName",
-            &reply_ptr,
-            DBUS_TYPE_STRING,
-            &tail_client_name,
-            DBUS_TYPE_STRING,
-            &tail_port_name,
-            DBUS_TYPE_STRING,
-            &head_client_name,
-            DBUS_TYPE_STRING,
-            &head_port_name,
-            DBUS_TYPE_INVALID)) {
-    error_msg("ConnectPortsByName() failed");
-    return false;
-  }
+  const auto& port = graph.ports.at(port_id);
 
-  return true;
+  return PortID::jack(graph.clients.at(port.client_id), port.name);
 }
 
-bool
-JackDriver::disconnect(const PortID& tail_id, const PortID& head_id)
+void
+JackDriver::emit_graph(const Graph& graph, const EventSink& sink) const
 {
-  const auto        tail_names       = PortNames(tail_id);
-  const auto        head_names       = PortNames(head_id);
-  const char* const tail_client_name = tail_names.client().c_str();
-  const char* const tail_port_name   = tail_names.port().c_str();
-  const char* const head_client_name = head_names.client().c_str();
-  const char* const head_port_name   = head_names.port().c_str();
+  Events events;
+  events.reserve(graph.clients.size() + graph.ports.size() +
+                 graph.connections.size());
 
-  DBusMessage* reply_ptr = nullptr;
+  for (const auto& client : graph.clients) {
+    // TODO: Pretty name?
+    events.emplace_back(
+      event::ClientCreated{ClientID::jack(client.second), {client.second}});
+  }
 
-  if (!call(true,
-            JACKDBUS_IFACE_PATCHBAY,
-            "DisconnectPortsByName",
-            &reply_ptr,
-            DBUS_TYPE_STRING,
-            &tail_client_name,
-            DBUS_TYPE_STRING,
-            &tail_port_name,
-            DBUS_TYPE_STRING,
-            &head_client_name,
-            DBUS_TYPE_STRING,
-            &head_port_name,
-            DBUS_TYPE_INVALID)) {
-    error_msg("DisconnectPortsByName() failed");
-    return false;
+  for (const auto& p : graph.ports) {
+    const auto& port = p.second;
+
+    events.emplace_back(
+      event::PortCreated{graph_port_id(graph, p.first),
+                         port_info(port.name, port.type, port.flags)});
   }
 
-  return true;
+  for (const auto& c : graph.connections) {
+    events.emplace_back(
+      event::PortsConnected{graph_port_id(graph, c.second.tail_id),
+                            graph_port_id(graph, c.second.head_id)});
+  }
+
+  sink(std::move(events));
 }
 
-uint32_t
-JackDriver::xruns()
+void
+JackDriver::emit_graph_changes(const Graph& old_graph, const Graph& new_graph)
 {
-  DBusMessage*  reply_ptr = nullptr;
-  dbus_uint32_t xruns     = 0U;
+  Events events;
+
+  // Remove connections, ports, and clients that are gone
+  for (const auto& c : old_graph.connections) {
+    if (!new_graph.connections.count(c.first)) {
+      events.emplace_back(
+        event::PortsDisconnected{graph_port_id(old_graph, c.second.tail_id),
+                                 graph_port_id(old_graph, c.second.head_id)});
+    }
+  }
 
-  if (_server_responding && !_server_started) {
-    return 0;
+  for (const auto& p : old_graph.ports) {
+    if (!new_graph.ports.count(p.first)) {
+      events.emplace_back(
+        event::PortDestroyed{graph_port_id(old_graph, p.first)});
+    }
   }
 
-  if (!call(true,
-            JACKDBUS_IFACE_CONTROL,
-            "GetXruns",
-            &reply_ptr,
-            DBUS_TYPE_INVALID)) {
-    return 0;
+  for (const auto& client : old_graph.clients) {
+    if (!new_graph.clients.count(client.first)) {
+      events.emplace_back(
+        event::ClientDestroyed{ClientID::jack(client.second)});
+    }
   }
 
-  if (!dbus_message_get_args(
-        reply_ptr, &_dbus_error, DBUS_TYPE_UINT32, &xruns, DBUS_TYPE_INVALID)) {
-    dbus_message_unref(reply_ptr);
-    dbus_error_free(&_dbus_error);
-    error_msg("Decoding reply of GetXruns failed");
-    return 0;
+  // Add clients, ports, and connections that are new
+  for (const auto& client : new_graph.clients) {
+    if (!old_graph.clients.count(client.first)) {
+      events.emplace_back(
+        event::ClientCreated{ClientID::jack(client.second), {client.second}});
+    }
   }
 
-  dbus_message_unref(reply_ptr);
+  for (const auto& p : new_graph.ports) {
+    if (!old_graph.ports.count(p.first)) {
+      const auto& port = p.second;
 
-  return xruns;
+      events.emplace_back(
+        event::PortCreated{graph_port_id(new_graph, p.first),
+                           port_info(port.name, port.type, port.flags)});
+    }
+  }
+
+  for (const auto& c : new_graph.connections) {
+    if (!old_graph.connections.count(c.first)) {
+      events.emplace_back(
+        event::PortsConnected{graph_port_id(new_graph, c.second.tail_id),
+                              graph_port_id(new_graph, c.second.head_id)});
+    }
+  }
+
+  _emit_events(std::move(events));
 }
 
-void
-JackDriver::reset_xruns()
+bool
+JackDriver::apply_version(const dbus_uint64_t new_graph_version)
 {
-  DBusMessage* reply_ptr = nullptr;
+  if (!_graph_valid || new_graph_version == _graph.version + 1U) {
+    _graph.version = new_graph_version;
+    return true;
+  }
 
-  if (!call(true,
-            JACKDBUS_IFACE_CONTROL,
-            "ResetXruns",
-            &reply_ptr,
-            DBUS_TYPE_INVALID)) {
-    return;
+  if (new_graph_version <= _graph.version) {
+    return false; // Already included in the graph by a resync
   }
 
-  dbus_message_unref(reply_ptr);
+  // Some signals were missed, so get the whole graph and emit what changed
+  info_msg(fmt::format("Graph version jumped from {} to {}, resynchronizing",
+                       _graph.version,
+                       new_graph_version));
+
+  Graph graph;
+  if (get_graph(0U, graph)) {
+    emit_graph_changes(_graph, graph);
+    _graph = std::move(graph);
+  } else {
+    _graph_valid = false;
+  }
+
+  return false;
 }
 
-uint32_t
-JackDriver::buffer_size()
+void
+JackDriver::refresh(const EventSink& sink)
 {
-  DBusMessage*  reply_ptr   = nullptr;
-  dbus_uint32_t buffer_size = 0U;
+  // Only get the full graph if it has changed since the last time
+  const dbus_uint64_t known_version = _graph_valid ? _graph.version : 0U;
 
-  if (_server_responding && !_server_started) {
-    return 4096;
+  Graph graph;
+  if (!get_graph(known_version, graph)) {
+    return;
   }
 
-  if (!call(true,
-            JACKDBUS_IFACE_CONTROL,
-            "GetBufferSize",
-            &reply_ptr,
-            DBUS_TYPE_INVALID)) {
-    return 4096;
+  if (!_graph_valid || graph.version != known_version) {
+    _graph       = std::move(graph);
+    _graph_valid = true;
   }
 
-  if (!dbus_message_get_args(reply_ptr,
-                             &_dbus_error,
-                             DBUS_TYPE_UINT32,
-                             &buffer_size,
-                             DBUS_TYPE_INVALID)) {
-    dbus_message_unref(reply_ptr);
-    dbus_error_free(&_dbus_error);
-    error_msg("Decoding reply of GetBufferSize failed");
-    return 4096;
-  }
+  emit_graph(_graph, sink);
+}
 
-  dbus_message_unref(reply_ptr);
+std::vector<bool>
+JackDriver::connect_many(const std::vector<Connection>& connections)
+{
+  return call_many("ConnectPortsByName", connections);
+}
 
-  return buffer_size;
+std::vector<bool>
+JackDriver::disconnect_many(const std::vector<Connection>& connections)
+{
+  return call_many("DisconnectPortsByName", connections);
 }
 
 bool
-JackDriver::set_buffer_size(const uint32_t frames)
+JackDriver::monitor(const PortID&)
 {
-  DBusMessage*  reply_ptr   = nullptr;
-  dbus_uint32_t buffer_size = frames;
+  error_msg("Monitoring ports is not supported via D-Bus");
+  return false;
+}
 
-  if (!call(true,
-            JACKDBUS_IFACE_CONTROL,
-            "SetBufferSize",
-            &reply_ptr,
-            DBUS_TYPE_UINT32,
-            &buffer_size,
-            DBUS_TYPE_INVALID)) {
-    return false;
-  }
+void
+JackDriver::unmonitor(const PortID&)
+{}
 
-  dbus_message_unref(reply_ptr);
+std::optional<PortActivity>
+JackDriver::activity(const PortID&)
+{
+  return {};
+}
 
-  return true;
+uint32_t
+JackDriver::xruns()
+{
+  query("GetXruns", &JackDriver::on_get_xruns);
+  return _xruns;
+}
+
+void
+JackDriver::reset_xruns()
+{
+  _xruns = 0U;
+  call_async("ResetXruns", nullptr, DBUS_TYPE_INVALID);
 }
 
 uint32_t
-JackDriver::sample_rate()
+JackDriver::buffer_size()
 {
-  DBusMessage*  reply_ptr   = nullptr;
-  dbus_uint32_t sample_rate = 0U;
+  query("GetBufferSize", &JackDriver::on_get_buffer_size);
+  return _buffer_size;
+}
 
-  if (!call(true,
-            JACKDBUS_IFACE_CONTROL,
-            "GetSampleRate",
-            &reply_ptr,
-            DBUS_TYPE_INVALID)) {
-    return false;
-  }
+bool
+JackDriver::set_buffer_size(const uint32_t frames)
+{
+  dbus_uint32_t buffer_size = frames;
 
-  if (!dbus_message_get_args(reply_ptr,
-                             &_dbus_error,
-                             DBUS_TYPE_UINT32,
-                             &sample_rate,
-                             DBUS_TYPE_INVALID)) {
-    dbus_message_unref(reply_ptr);
-    dbus_error_free(&_dbus_error);
-    error_msg("Decoding reply of GetSampleRate failed");
+  if (!call_async("SetBufferSize",
+                  &JackDriver::on_set_buffer_size,
+                  DBUS_TYPE_UINT32,
+                  &buffer_size,
+                  DBUS_TYPE_INVALID)) {
     return false;
   }
 
-  dbus_message_unref(reply_ptr);
+  _buffer_size = frames;
+  return true;
+}
 
-  return sample_rate;
+uint32_t
+JackDriver::sample_rate()
+{
+  query("GetSampleRate", &JackDriver::on_get_sample_rate);
+  return _sample_rate;
 }
 
 PortType
@@ -955,10 +1338,10 @@ JackDriver::info_msg(const std::string& msg) const
 } // namespace
 
 std::unique_ptr<AudioDriver>
-make_jack_driver(ILog& log, Driver::EventSink emit_event)
+make_jack_driver(ILog& log, Driver::EventSink emit_events)
 {
   return std::unique_ptr<AudioDriver>{
-    new JackDriver{log, std::move(emit_event)}};
+    new JackDriver{log, std::move(emit_events)}};
 }
 
 } // namespace patchage
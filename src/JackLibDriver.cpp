@@ -5,16 +5,19 @@
 #include "ClientID.hpp"
 #include "ClientInfo.hpp"
 #include "ClientType.hpp"
+#include "Connection.hpp"
 #include "Driver.hpp"
 #include "Event.hpp"
 #include "ILog.hpp"
 #include "PortID.hpp"
 #include "PortInfo.hpp"
+#include "PortActivity.hpp"
 #include "PortNames.hpp"
 #include "PortType.hpp"
 #include "SignalDirection.hpp"
 #include "jackey.h"
 #include "make_jack_driver.hpp"
+#include "measure_level.hpp"
 #include "patchage_config.h"
 #include "warnings.hpp"
 
@@ -27,10 +30,17 @@ PATCHAGE_DISABLE_FMT_WARNINGS
 PATCHAGE_RESTORE_WARNINGS
 
 #include <jack/jack.h>
+#include <jack/midiport.h>
 #include <jack/types.h>
 
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -39,15 +49,22 @@ PATCHAGE_RESTORE_WARNINGS
 #include <unordered_set>
 #include <utility>
 #include <variant>
+#include <vector>
 
 namespace patchage {
 namespace {
 
+/// Maximum number of ports that can be monitored at once
+constexpr size_t max_monitors = 64U;
+
+/// Time over which RMS levels are averaged, in seconds
+constexpr float rms_window = 0.3f;
+
 /// Driver for JACK audio and midi ports that uses libjack
 class JackLibDriver : public AudioDriver
 {
 public:
-  explicit JackLibDriver(ILog& log, EventSink emit_event);
+  explicit JackLibDriver(ILog& log, EventSink emit_events);
 
   JackLibDriver(const JackLibDriver&)            = delete;
   JackLibDriver& operator=(const JackLibDriver&) = delete;
@@ -62,8 +79,14 @@ public:
   void detach() override;
   bool is_attached() const override;
   void refresh(const EventSink& sink) override;
-  bool connect(const PortID& tail_id, const PortID& head_id) override;
-  bool disconnect(const PortID& tail_id, const PortID& head_id) override;
+  std::vector<bool>
+  connect_many(const std::vector<Connection>& connections) override;
+  std::vector<bool>
+  disconnect_many(const std::vector<Connection>& connections) override;
+  bool monitor(const PortID& id) override;
+  void unmonitor(const PortID& id) override;
+  std::optional<PortActivity> activity(const PortID& id) override;
+  void                        flush_events() override;
 
   // AudioDriver interface
   uint32_t xruns() override;
@@ -73,9 +96,33 @@ public:
   uint32_t sample_rate() override;
 
 private:
+  /// A hidden input port connected to a monitored port
+  struct Monitor {
+    std::atomic<jack_port_t*> port{nullptr};
+    std::atomic<bool>         is_midi{false};
+    std::atomic<float>        peak{0.0f};
+    std::atomic<float>        mean_square{0.0f};
+    std::atomic<uint32_t>     n_events{0U};
+
+    jack_port_t* retired{nullptr};  ///< Removed port not yet unregistered
+    uint32_t     retired_cycle{0U}; ///< Process cycle when it was removed
+  };
+
   static ClientInfo get_client_info(const char* name);
   PortInfo          get_port_info(const jack_port_t* port);
 
+  bool is_mine(const jack_port_t* port) const;
+  void queue_event(Event event);
+  void clear_monitors();
+  void forget_cleared_monitors();
+  void unregister_retired();
+
+  static int on_process(jack_nframes_t nframes, void* driver);
+
+  static int on_buffer_size(jack_nframes_t nframes, void* driver);
+
+  static int on_sample_rate(jack_nframes_t rate, void* driver);
+
   static void on_client(const char* name, int registered, void* driver);
 
   static void on_port(jack_port_id_t port_id, int registered, void* driver);
@@ -90,16 +137,28 @@ private:
   static void on_shutdown(void* driver);
 
   ILog&      _log;
-  std::mutex _shutdown_mutex;
+  std::mutex _shutdown_mutex; ///< Held while the client is used or changed
+  std::mutex _events_mutex;   ///< Held while events are queued or emitted
+  Events     _events;         ///< Events from callbacks not yet emitted
 
   jack_client_t* _client       = nullptr;
-  jack_nframes_t _buffer_size  = 0U;
-  uint32_t       _xruns        = 0U;
   bool           _is_activated = false;
+
+  // State that the GUI reads every update, without waiting for the client
+  std::atomic<bool>     _attached{false}; ///< True iff there is a client
+  std::atomic<uint32_t> _buffer_size{0U}; ///< Set by callback
+  std::atomic<uint32_t> _sample_rate{0U}; ///< Set by callback
+  std::atomic<uint32_t> _xruns{0U};       ///< Incremented by callback
+  std::atomic<uint32_t> _generation{0U};  ///< Incremented on clearing monitors
+
+  std::array<Monitor, max_monitors> _monitors;      ///< Used in process
+  std::map<PortID, size_t>          _monitor_slots; ///< Index into monitors
+  uint32_t              _slots_generation{0U}; ///< Generation of the slots
+  std::atomic<uint32_t> _cycles{0U};           ///< Finished process runs
 };
 
-JackLibDriver::JackLibDriver(ILog& log, EventSink emit_event)
-  : AudioDriver{std::move(emit_event)}
+JackLibDriver::JackLibDriver(ILog& log, EventSink emit_events)
+  : AudioDriver{std::move(emit_events)}
   , _log{log}
 {}
 
@@ -108,20 +167,30 @@ JackLibDriver::~JackLibDriver() = default;
 void
 JackLibDriver::attach(const bool launch_daemon)
 {
-  if (_client) {
+  if (_attached.load()) {
     return; // Already connected
   }
 
   const jack_options_t options =
     (!launch_daemon) ? JackNoStartServer : JackNullOption;
 
-  if (!(_client = jack_client_open("Patchage", options, nullptr))) {
+  jack_client_t* const client = jack_client_open("Patchage", options, nullptr);
+  if (!client) {
     _log.error("[JACK] Unable to create client");
-    _is_activated = false;
     return;
   }
 
+  const std::lock_guard<std::mutex> lock{_shutdown_mutex};
+
+  _client = client;
+  clear_monitors();
+  _sample_rate.store(jack_get_sample_rate(_client));
+  _attached.store(true);
+
   jack_on_shutdown(_client, on_shutdown, this);
+  jack_set_process_callback(_client, on_process, this);
+  jack_set_buffer_size_callback(_client, on_buffer_size, this);
+  jack_set_sample_rate_callback(_client, on_sample_rate, this);
   jack_set_client_registration_callback(_client, on_client, this);
   jack_set_port_registration_callback(_client, on_port, this);
   jack_set_port_connect_callback(_client, on_connection, this);
@@ -130,14 +199,15 @@ JackLibDriver::attach(const bool launch_daemon)
   if (jack_activate(_client)) {
     _log.error("[JACK] Client activation failed");
     _is_activated = false;
-    _buffer_size  = 0;
+    _buffer_size.store(0U);
     return;
   }
 
   _is_activated = true;
-  _buffer_size  = jack_get_buffer_size(_client);
+  _buffer_size.store(jack_get_buffer_size(_client));
 
-  _emit_event(event::DriverAttached{ClientType::jack});
+  queue_event(event::DriverAttached{ClientType::jack});
+  flush_events();
 }
 
 void
@@ -151,14 +221,84 @@ JackLibDriver::detach()
     _client = nullptr;
   }
 
+  _attached.store(false);
+  clear_monitors();
   _is_activated = false;
-  _emit_event(event::DriverDetached{ClientType::jack});
+  queue_event(event::DriverDetached{ClientType::jack});
+  flush_events();
 }
 
 bool
 JackLibDriver::is_attached() const
 {
-  return _client != nullptr;
+  return _attached.load();
+}
+
+void
+JackLibDriver::queue_event(Event event)
+{
+  const std::lock_guard<std::mutex> lock{_events_mutex};
+
+  _events.push_back(std::move(event));
+}
+
+void
+JackLibDriver::flush_events()
+{
+  // Emit with the lock held so batches from different threads stay in order
+  const std::lock_guard<std::mutex> lock{_events_mutex};
+
+  if (!_events.empty()) {
+    Events events;
+    events.swap(_events);
+    _emit_events(std::move(events));
+  }
+}
+
+bool
+JackLibDriver::is_mine(const jack_port_t* const port) const
+{
+  return _client && port && jack_port_is_mine(_client, port);
+}
+
+void
+JackLibDriver::clear_monitors()
+{
+  for (auto& monitor : _monitors) {
+    monitor.port.store(nullptr, std::memory_order_release);
+    monitor.retired = nullptr;
+  }
+
+  // The slots are only used by the GUI thread, which forgets them later
+  _generation.fetch_add(1U, std::memory_order_release);
+}
+
+void
+JackLibDriver::forget_cleared_monitors()
+{
+  const uint32_t generation = _generation.load(std::memory_order_acquire);
+  if (_slots_generation != generation) {
+    _monitor_slots.clear();
+    _slots_generation = generation;
+  }
+}
+
+void
+JackLibDriver::unregister_retired()
+{
+  const uint32_t cycles = _cycles.load(std::memory_order_acquire);
+
+  for (auto& monitor : _monitors) {
+    // The process thread may still use the port until a cycle has finished
+    if (monitor.retired &&
+        (!_is_activated || cycles != monitor.retired_cycle)) {
+      if (_client) {
+        jack_port_unregister(_client, monitor.retired);
+      }
+
+      monitor.retired = nullptr;
+    }
+  }
 }
 
 std::string
@@ -249,6 +389,9 @@ JackLibDriver::refresh(const EventSink& sink)
     return;
   }
 
+  // Emit any older changes first so they don't follow the current state
+  flush_events();
+
   // Get all existing ports
   const char** const ports = jack_get_ports(_client, nullptr, nullptr, 0);
   if (!ports) {
@@ -258,36 +401,47 @@ JackLibDriver::refresh(const EventSink& sink)
   // Get all client names (to only send a creation event once for each)
   std::unordered_set<std::string> client_names;
   for (auto i = 0U; ports[i]; ++i) {
-    client_names.insert(PortID::jack(ports[i]).client().jack_name());
+    if (!is_mine(jack_port_by_name(_client, ports[i]))) {
+      client_names.insert(PortID::jack(ports[i]).client().jack_name());
+    }
   }
 
-  // Emit all clients
+  // Add all clients
+  Events events;
   for (const auto& client_name : client_names) {
-    sink({event::ClientCreated{ClientID::jack(client_name),
-                               get_client_info(client_name.c_str())}});
+    events.emplace_back(event::ClientCreated{
+      ClientID::jack(client_name), get_client_info(client_name.c_str())});
   }
 
-  // Emit all ports
+  // Add all ports
   for (auto i = 0U; ports[i]; ++i) {
     const jack_port_t* const port = jack_port_by_name(_client, ports[i]);
 
-    sink({event::PortCreated{PortID::jack(ports[i]), get_port_info(port)}});
+    if (!is_mine(port)) {
+      events.emplace_back(
+        event::PortCreated{PortID::jack(ports[i]), get_port_info(port)});
+    }
   }
 
   // Get all connections (again to only create them once)
   std::set<std::pair<std::string, std::string>> connections;
   for (auto i = 0U; ports[i]; ++i) {
     const jack_port_t* const port = jack_port_by_name(_client, ports[i]);
-    const char** const peers = jack_port_get_all_connections(_client, port);
+    if (is_mine(port)) {
+      continue;
+    }
 
+    const char** const peers = jack_port_get_all_connections(_client, port);
     if (peers) {
       const auto flags = static_cast<unsigned>(jack_port_flags(port));
-      if (flags & JackPortIsInput) {
-        for (auto j = 0U; peers[j]; ++j) {
-          connections.emplace(peers[j], ports[i]);
+      for (auto j = 0U; peers[j]; ++j) {
+        if (is_mine(jack_port_by_name(_client, peers[j]))) {
+          continue;
         }
-      } else {
-        for (auto j = 0U; peers[j]; ++j) {
+
+        if (flags & JackPortIsInput) {
+          connections.emplace(peers[j], ports[i]);
+        } else {
           connections.emplace(ports[i], peers[j]);
         }
       }
@@ -296,86 +450,247 @@ JackLibDriver::refresh(const EventSink& sink)
     }
   }
 
-  // Emit all connections
+  // Add all connections
   for (const auto& connection : connections) {
-    sink({event::PortsConnected{PortID::jack(connection.first),
-                                PortID::jack(connection.second)}});
+    events.emplace_back(event::PortsConnected{
+      PortID::jack(connection.first), PortID::jack(connection.second)});
   }
 
   jack_free(ports);
+
+  // Emit everything at once
+  sink(std::move(events));
 }
 
-bool
-JackLibDriver::connect(const PortID& tail_id, const PortID& head_id)
+std::vector<bool>
+JackLibDriver::connect_many(const std::vector<Connection>& connections)
 {
+  const std::lock_guard<std::mutex> lock{_shutdown_mutex};
+
+  std::vector<bool> results(connections.size(), false);
   if (!_client) {
-    return false;
+    return results;
   }
 
-  const auto& tail_name = tail_id.jack_name();
-  const auto& head_name = head_id.jack_name();
+  int error = 0;
+  for (size_t i = 0U; i < connections.size(); ++i) {
+    const int result = jack_connect(_client,
+                                    connections[i].tail.jack_name().c_str(),
+                                    connections[i].head.jack_name().c_str());
 
-  const int result =
-    jack_connect(_client, tail_name.c_str(), head_name.c_str());
+    results[i] = !result;
+    if (result && !error) {
+      error = result;
+    }
+  }
 
-  if (result) {
-    _log.error(
-      fmt::format("[JACK] Failed to connect {} => {}", tail_name, head_name));
-    return false;
+  if (error) {
+    _log.error(failure_message("[JACK] Failed to connect",
+                               connections,
+                               results,
+                               error == EEXIST
+                                 ? "already connected"
+                                 : fmt::format("error {}", error)));
   }
 
-  return true;
+  return results;
+}
+
+std::vector<bool>
+JackLibDriver::disconnect_many(const std::vector<Connection>& connections)
+{
+  const std::lock_guard<std::mutex> lock{_shutdown_mutex};
+
+  std::vector<bool> results(connections.size(), false);
+  if (!_client) {
+    return results;
+  }
+
+  int error = 0;
+  for (size_t i = 0U; i < connections.size(); ++i) {
+    const int result =
+      jack_disconnect(_client,
+                      connections[i].tail.jack_name().c_str(),
+                      connections[i].head.jack_name().c_str());
+
+    results[i] = !result;
+    if (result && !error) {
+      error = result;
+    }
+  }
+
+  if (error) {
+    _log.error(failure_message("[JACK] Failed to disconnect",
+                               connections,
+                               results,
+                               fmt::format("error {}", error)));
+  }
+
+  return results;
 }
 
 bool
-JackLibDriver::disconnect(const PortID& tail_id, const PortID& head_id)
+JackLibDriver::monitor(const PortID& id)
 {
+  const std::lock_guard<std::mutex> lock{_shutdown_mutex};
+
   if (!_client) {
     return false;
   }
 
-  const auto& tail_name = tail_id.jack_name();
-  const auto& head_name = head_id.jack_name();
+  forget_cleared_monitors();
+  if (_monitor_slots.count(id)) {
+    return true; // Already monitored
+  }
+
+  unregister_retired();
+
+  const auto&              source_name = id.jack_name();
+  const jack_port_t* const source =
+    jack_port_by_name(_client, source_name.c_str());
+  if (!source) {
+    _log.error(fmt::format("[JACK] Unable to find port {}", source_name));
+    return false;
+  }
 
-  const int result =
-    jack_disconnect(_client, tail_name.c_str(), head_name.c_str());
+  const auto flags = static_cast<unsigned>(jack_port_flags(source));
 
-  if (result) {
-    _log.error(fmt::format(
-      "[JACK] Failed to disconnect {} => {}", tail_name, head_name));
+  const char* const source_type = jack_port_type(source);
+  const bool        is_midi     = !strcmp(source_type, JACK_DEFAULT_MIDI_TYPE);
+  if ((flags & JackPortIsInput) ||
+      (!is_midi && strcmp(source_type, JACK_DEFAULT_AUDIO_TYPE))) {
+    _log.warning(fmt::format(
+      "[JACK] Only audio, CV, and MIDI outputs can be monitored, not {}",
+      source_name));
     return false;
   }
 
+  // Find a free slot for the monitor
+  size_t slot = 0U;
+  while (slot < max_monitors &&
+         (_monitors[slot].port.load(std::memory_order_relaxed) ||
+          _monitors[slot].retired)) {
+    ++slot;
+  }
+
+  if (slot == max_monitors) {
+    _log.warning(fmt::format(
+      "[JACK] Unable to monitor more than {} ports at once", max_monitors));
+    return false;
+  }
+
+  // Register a hidden port to receive the signal
+  const auto         port_name = fmt::format("monitor_{}", slot + 1U);
+  jack_port_t* const port =
+    jack_port_register(_client,
+                       port_name.c_str(),
+                       source_type,
+                       JackPortIsInput | JackPortIsTerminal,
+                       0);
+  if (!port) {
+    _log.error(fmt::format("[JACK] Failed to register port {}", port_name));
+    return false;
+  }
+
+  if (jack_connect(_client, source_name.c_str(), jack_port_name(port))) {
+    _log.error(
+      fmt::format("[JACK] Failed to connect monitor to {}", source_name));
+    jack_port_unregister(_client, port);
+    return false;
+  }
+
+  // Publish the port to the process thread
+  Monitor& monitor = _monitors[slot];
+  monitor.is_midi.store(is_midi, std::memory_order_relaxed);
+  monitor.peak.store(0.0f, std::memory_order_relaxed);
+  monitor.mean_square.store(0.0f, std::memory_order_relaxed);
+  monitor.n_events.store(0U, std::memory_order_relaxed);
+  monitor.port.store(port, std::memory_order_release);
+
+  _monitor_slots.emplace(id, slot);
   return true;
 }
 
+void
+JackLibDriver::unmonitor(const PortID& id)
+{
+  const std::lock_guard<std::mutex> lock{_shutdown_mutex};
+
+  forget_cleared_monitors();
+  const auto s = _monitor_slots.find(id);
+  if (s == _monitor_slots.end()) {
+    return;
+  }
+
+  // Hide the port from the process thread, and unregister it once it's done
+  Monitor& monitor = _monitors[s->second];
+  monitor.retired  = monitor.port.exchange(nullptr, std::memory_order_acq_rel);
+
+  // Read the count after the exchange, since a running cycle may have the port
+  monitor.retired_cycle = _cycles.load(std::memory_order_acquire);
+
+  _monitor_slots.erase(s);
+  unregister_retired();
+}
+
+std::optional<PortActivity>
+JackLibDriver::activity(const PortID& id)
+{
+  // Called for every meter on every update, so this never waits for a lock
+  if (_slots_generation != _generation.load(std::memory_order_acquire)) {
+    return {}; // Monitors were cleared since the slots were made
+  }
+
+  const auto s = _monitor_slots.find(id);
+  if (s == _monitor_slots.end()) {
+    return {};
+  }
+
+  Monitor& monitor = _monitors[s->second];
+
+  const float peak = monitor.peak.exchange(0.0f, std::memory_order_relaxed);
+  const float rms =
+    std::sqrt(monitor.mean_square.load(std::memory_order_relaxed));
+  const uint32_t n_events =
+    monitor.n_events.exchange(0U, std::memory_order_relaxed);
+
+  return PortActivity{peak, rms, n_events};
+}
+
 uint32_t
 JackLibDriver::xruns()
 {
-  return _xruns;
+  return _xruns.load(std::memory_order_relaxed);
 }
 
 void
 JackLibDriver::reset_xruns()
 {
-  _xruns = 0;
+  _xruns.store(0U, std::memory_order_relaxed);
 }
 
 uint32_t
 JackLibDriver::buffer_size()
 {
-  return _is_activated ? _buffer_size : jack_get_buffer_size(_client);
+  return _buffer_size.load(std::memory_order_relaxed);
 }
 
 bool
 JackLibDriver::set_buffer_size(const uint32_t frames)
 {
-  if (!_client) {
-    _buffer_size = frames;
+  if (frames == _buffer_size.load()) {
     return true;
   }
 
-  if (buffer_size() == frames) {
+  // Don't freeze the GUI while a connection command waits for the server
+  const std::unique_lock<std::mutex> lock{_shutdown_mutex, std::try_to_lock};
+  if (!lock.owns_lock()) {
+    _log.error("[JACK] Server is busy, unable to set buffer size");
+    return false;
+  }
+
+  if (!_client) {
+    _buffer_size.store(frames);
     return true;
   }
 
@@ -384,14 +699,14 @@ JackLibDriver::set_buffer_size(const uint32_t frames)
     return false;
   }
 
-  _buffer_size = frames;
+  _buffer_size.store(frames);
   return true;
 }
 
 uint32_t
 JackLibDriver::sample_rate()
 {
-  return jack_get_sample_rate(_client);
+  return _sample_rate.load(std::memory_order_relaxed);
 }
 
 void
@@ -402,9 +717,9 @@ JackLibDriver::on_client(const char* const name,
   auto* const me = static_cast<JackLibDriver*>(driver);
 
   if (registered) {
-    me->_emit_event(event::ClientCreated{ClientID::jack(name), {name}});
+    me->queue_event(event::ClientCreated{ClientID::jack(name), {name}});
   } else {
-    me->_emit_event(event::ClientDestroyed{ClientID::jack(name)});
+    me->queue_event(event::ClientDestroyed{ClientID::jack(name)});
   }
 }
 
@@ -416,13 +731,17 @@ JackLibDriver::on_port(const jack_port_id_t port_id,
   auto* const me = static_cast<JackLibDriver*>(driver);
 
   jack_port_t* const port = jack_port_by_id(me->_client, port_id);
-  const char* const  name = jack_port_name(port);
-  const auto         id   = PortID::jack(name);
+  if (me->is_mine(port)) {
+    return; // Ignore hidden monitor ports
+  }
+
+  const char* const name = jack_port_name(port);
+  const auto        id   = PortID::jack(name);
 
   if (registered) {
-    me->_emit_event(event::PortCreated{id, me->get_port_info(port)});
+    me->queue_event(event::PortCreated{id, me->get_port_info(port)});
   } else {
-    me->_emit_event(event::PortDestroyed{id});
+    me->queue_event(event::PortDestroyed{id});
   }
 }
 
@@ -436,24 +755,101 @@ JackLibDriver::on_connection(const jack_port_id_t src,
 
   jack_port_t* const src_port = jack_port_by_id(me->_client, src);
   jack_port_t* const dst_port = jack_port_by_id(me->_client, dst);
-  const char* const  src_name = jack_port_name(src_port);
-  const char* const  dst_name = jack_port_name(dst_port);
+  if (me->is_mine(src_port) || me->is_mine(dst_port)) {
+    return; // Ignore connections to hidden monitor ports
+  }
+
+  const char* const src_name = jack_port_name(src_port);
+  const char* const dst_name = jack_port_name(dst_port);
 
   if (connect) {
-    me->_emit_event(
+    me->queue_event(
       event::PortsConnected{PortID::jack(src_name), PortID::jack(dst_name)});
   } else {
-    me->_emit_event(
+    me->queue_event(
       event::PortsDisconnected{PortID::jack(src_name), PortID::jack(dst_name)});
   }
 }
 
+int
+JackLibDriver::on_process(const jack_nframes_t nframes, void* const driver)
+{
+  auto* const    me = static_cast<JackLibDriver*>(driver);
+  const uint32_t rate = me->_sample_rate.load(std::memory_order_relaxed);
+  if (!nframes || !rate) {
+    me->_cycles.fetch_add(1U, std::memory_order_release);
+    return 0;
+  }
+
+  // Coefficient for a one-pole lowpass filter over the RMS window
+  const float coefficient =
+    1.0f - std::exp(-static_cast<float>(nframes) /
+                    (rms_window * static_cast<float>(rate)));
+
+  for (auto& monitor : me->_monitors) {
+    jack_port_t* const port = monitor.port.load(std::memory_order_acquire);
+    if (!port) {
+      continue;
+    }
+
+    if (monitor.is_midi.load(std::memory_order_relaxed)) {
+      void* const buffer = jack_port_get_buffer(port, nframes);
+
+      monitor.n_events.fetch_add(jack_midi_get_event_count(buffer),
+                                 std::memory_order_relaxed);
+      continue;
+    }
+
+    const auto* const buffer =
+      static_cast<const float*>(jack_port_get_buffer(port, nframes));
+
+    const BlockLevel level = measure_level(buffer, nframes);
+
+    // Hold the peak until it is read by the GUI
+    if (level.peak > monitor.peak.load(std::memory_order_relaxed)) {
+      monitor.peak.store(level.peak, std::memory_order_relaxed);
+    }
+
+    const float mean_square =
+      monitor.mean_square.load(std::memory_order_relaxed);
+
+    const float block_mean_square =
+      level.sum_squares / static_cast<float>(nframes);
+
+    monitor.mean_square.store(
+      mean_square + (coefficient * (block_mean_square - mean_square)),
+      std::memory_order_relaxed);
+  }
+
+  // Let the main thread know that no port is in use from before this run
+  me->_cycles.fetch_add(1U, std::memory_order_release);
+  return 0;
+}
+
+int
+JackLibDriver::on_buffer_size(const jack_nframes_t nframes, void* const driver)
+{
+  auto* const me = static_cast<JackLibDriver*>(driver);
+
+  me->_buffer_size.store(nframes, std::memory_order_relaxed);
+  return 0;
+}
+
+int
+JackLibDriver::on_sample_rate(const jack_nframes_t rate, void* const driver)
+{
+  auto* const me = static_cast<JackLibDriver*>(driver);
+
+  me->_sample_rate.store(rate, std::memory_order_relaxed);
+  return 0;
+}
+
 int
 JackLibDriver::on_xrun(void* const driver)
 {
   auto* const me = static_cast<JackLibDriver*>(driver);
 
-  ++me->_xruns;
+  me->_xruns.fetch_add(1U, std::memory_order_relaxed);
 
   return 0;
 }
@@ -474,19 +870,22 @@ JackLibDriver::on_shutdown(void* const driver)
 
   const std::lock_guard<std::mutex> lock{me->_shutdown_mutex};
 
+  me->_attached.store(false);
   me->_client       = nullptr;
   me->_is_activated = false;
+  me->clear_monitors();
 
-  me->_emit_event(event::DriverDetached{ClientType::jack});
+  me->queue_event(event::DriverDetached{ClientType::jack});
+  me->flush_events();
 }
 
 } // namespace
 
 std::unique_ptr<AudioDriver>
-make_jack_driver(ILog& log, Driver::EventSink emit_event)
+make_jack_driver(ILog& log, Driver::EventSink emit_events)
 {
   return std::unique_ptr<AudioDriver>{
-    new JackLibDriver{log, std::move(emit_event)}};
+    new JackLibDriver{log, std::move(emit_events)}};
 }
 
 } // namespace patchage
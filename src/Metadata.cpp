@@ -1,17 +1,44 @@
-// Copyright 2014-2020 David Robillard <d@drobilla.net>
+// Copyright 2014-2026 David Robillard <d@drobilla.net>
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "Metadata.hpp"
 
 #include "ClientID.hpp"
 #include "ClientInfo.hpp"
+#include "ClientType.hpp"
 #include "PortID.hpp"
 #include "PortInfo.hpp"
+#include "SignalDirection.hpp"
 
+#include <map>
 #include <optional>
+#include <string>
 #include <utility>
+#include <vector>
 
 namespace patchage {
+namespace {
+
+/// Return the ports of a client whose port names include the client label
+std::vector<std::pair<PortID, PortInfo>>
+labelled_client_ports(const std::map<PortID, PortInfo>& ports,
+                      const ClientID&                   id)
+{
+  std::vector<std::pair<PortID, PortInfo>> result;
+  if (id.type() == ClientType::alsa) {
+    // ALSA ports are sorted by client, then port
+    for (auto p = ports.lower_bound(PortID::alsa(id.alsa_id(), 0U, false));
+         p != ports.end() && p->first.type() == PortID::Type::alsa &&
+         p->first.alsa_client() == id.alsa_id();
+         ++p) {
+      result.emplace_back(*p);
+    }
+  }
+
+  return result;
+}
+
+} // namespace
 
 std::optional<ClientInfo>
 Metadata::client(const ClientID& id) const
@@ -35,15 +62,35 @@ Metadata::port(const PortID& id) const
   return i->second;
 }
 
+std::optional<std::string>
+Metadata::port_name(const PortID& id) const
+{
+  const auto i = _port_data.find(id);
+  if (i == _port_data.end()) {
+    return {};
+  }
+
+  return make_port_name(id, i->second);
+}
+
 void
 Metadata::set_client(const ClientID& id, const ClientInfo& info)
 {
+  const auto ports = labelled_client_ports(_port_data, id);
+  for (const auto& p : ports) {
+    remove_port_name(p.first, p.second);
+  }
+
   const auto i = _client_data.find(id);
   if (i == _client_data.end()) {
     _client_data.emplace(id, info);
   } else {
     i->second = info;
   }
+
+  for (const auto& p : ports) {
+    add_port_name(p.first, p.second);
+  }
 }
 
 void
@@ -53,20 +100,107 @@ Metadata::set_port(const PortID& id, const PortInfo& info)
   if (i == _port_data.end()) {
     _port_data.emplace(id, info);
   } else {
+    remove_port_name(id, i->second);
     i->second = info;
   }
+
+  add_port_name(id, info);
 }
 
 void
 Metadata::erase_client(const ClientID& id)
 {
+  for (const auto& p : labelled_client_ports(_port_data, id)) {
+    remove_port_name(p.first, p.second);
+  }
+
   _client_data.erase(id);
 }
 
 void
 Metadata::erase_port(const PortID& id)
 {
-  _port_data.erase(id);
+  const auto i = _port_data.find(id);
+  if (i != _port_data.end()) {
+    remove_port_name(id, i->second);
+    _port_data.erase(i);
+  }
+}
+
+void
+Metadata::erase_clients(const ClientType type)
+{
+  for (auto p = _port_data.begin(); p != _port_data.end();) {
+    if (p->first.type() == type) {
+      remove_port_name(p->first, p->second);
+      p = _port_data.erase(p);
+    } else {
+      ++p;
+    }
+  }
+
+  for (auto c = _client_data.begin(); c != _client_data.end();) {
+    if (c->first.type() == type) {
+      c = _client_data.erase(c);
+    } else {
+      ++c;
+    }
+  }
+}
+
+std::optional<std::string>
+Metadata::make_port_name(const PortID& id, const PortInfo& info) const
+{
+  switch (id.type()) {
+  case PortID::Type::jack:
+    return id.jack_name();
+
+  case PortID::Type::alsa: {
+    const auto c = _client_data.find(id.client());
+    if (c != _client_data.end()) {
+      return c->second.label + ":" + info.label;
+    }
+    break;
+  }
+  }
+
+  return {};
+}
+
+SignalDirection
+Metadata::port_direction(const PortID& id, const PortInfo& info)
+{
+  if (id.type() == PortID::Type::alsa) {
+    return id.alsa_is_input() ? SignalDirection::input
+                              : SignalDirection::output;
+  }
+
+  return info.direction;
+}
+
+void
+Metadata::add_port_name(const PortID& id, const PortInfo& info)
+{
+  if (auto name = make_port_name(id, info)) {
+    _port_names[{info.type, port_direction(id, info)}].emplace(
+      std::move(*name), id);
+  }
+}
+
+void
+Metadata::remove_port_name(const PortID& id, const PortInfo& info)
+{
+  if (const auto name = make_port_name(id, info)) {
+    NameIndex& names = _port_names[{info.type, port_direction(id, info)}];
+
+    const auto range = names.equal_range(*name);
+    for (auto n = range.first; n != range.second; ++n) {
+      if (n->second == id) {
+        names.erase(n);
+        break;
+      }
+    }
+  }
 }
 
 } // namespace patchage
@@ -8,12 +8,18 @@
 #include "ClientInfo.hpp"
 #include "PortID.hpp"
 #include "PortInfo.hpp"
+#include "PortType.hpp"
+#include "SignalDirection.hpp"
 
 #include <map>
 #include <optional>
+#include <string>
+#include <utility>
 
 namespace patchage {
 
+enum class ClientType;
+
 /// Cache of metadata about clients and ports beyond their IDs
 class Metadata
 {
@@ -23,18 +29,85 @@ public:
   std::optional<ClientInfo> client(const ClientID& id) const;
   std::optional<PortInfo>   port(const PortID& id) const;
 
+  /**
+     Return the full "client:port" name of a port.
+
+     This is the JACK port name, or the client and port labels for ALSA,
+     which are only known once the client has been set.
+  */
+  std::optional<std::string> port_name(const PortID& id) const;
+
   void set_client(const ClientID& id, const ClientInfo& info);
   void set_port(const PortID& id, const PortInfo& info);
 
   void erase_client(const ClientID& id);
   void erase_port(const PortID& id);
 
+  /// Erase every client and port of the given type
+  void erase_clients(ClientType type);
+
+  /// Call `visitor` with the ID and info of every known client
+  template<class Visitor>
+  void each_client(Visitor visitor) const
+  {
+    for (const auto& c : _client_data) {
+      visitor(c.first, c.second);
+    }
+  }
+
+  /// Call `visitor` with the ID and info of every known port
+  template<class Visitor>
+  void each_port(Visitor visitor) const
+  {
+    for (const auto& p : _port_data) {
+      visitor(p.first, p.second);
+    }
+  }
+
+  /**
+     Call `visitor` with the ID and name of every port named with a prefix.
+
+     Only ports of the given type and direction (input or output) are
+     visited, which are indexed separately.
+  */
+  template<class Visitor>
+  void each_port_named(const PortType        type,
+                       const SignalDirection direction,
+                       const std::string&    prefix,
+                       Visitor               visitor) const
+  {
+    const auto i = _port_names.find({type, direction});
+    if (i == _port_names.end()) {
+      return;
+    }
+
+    const NameIndex& names = i->second;
+    for (auto n = names.lower_bound(prefix);
+         n != names.end() && !n->first.compare(0, prefix.size(), prefix);
+         ++n) {
+      visitor(n->second, n->first);
+    }
+  }
+
+  /// Return the direction of a port, either input or output
+  static SignalDirection port_direction(const PortID&   id,
+                                        const PortInfo& info);
+
 private:
   using ClientData = std::map<ClientID, ClientInfo>;
   using PortData   = std::map<PortID, PortInfo>;
+  using NameIndex  = std::multimap<std::string, PortID>;
+  using PortKind   = std::pair<PortType, SignalDirection>;
+
+  std::optional<std::string> make_port_name(const PortID&   id,
+                                            const PortInfo& info) const;
+
+  void add_port_name(const PortID& id, const PortInfo& info);
+  void remove_port_name(const PortID& id, const PortInfo& info);
 
   ClientData _client_data;
   PortData   _port_data;
+  std::map<PortKind, NameIndex> _port_names; ///< Port names by kind
 };
 
 } // namespace patchage
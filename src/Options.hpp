@@ -9,6 +9,7 @@ namespace patchage {
 struct Options {
   bool alsa_driver_autoattach = true;
   bool jack_driver_autoattach = true;
+  bool profile_startup        = false;
 };
 
 } // namespace patchage
@@ -8,20 +8,25 @@
 #include "Canvas.hpp"
 #include "CanvasModule.hpp"
 #include "CanvasPort.hpp"
+#include "ClientType.hpp"
 #include "Configuration.hpp"
+#include "ControlServer.hpp"
 #include "Coord.hpp"
 #include "Driver.hpp"
 #include "Drivers.hpp"
 #include "Event.hpp"
 #include "Legend.hpp"
 #include "Options.hpp"
+#include "PortID.hpp"
 #include "PortType.hpp"
 #include "Reactor.hpp"
 #include "Setting.hpp"
+#include "Snapshot.hpp"
 #include "TextViewLog.hpp"
 #include "UIFile.hpp"
 #include "Widget.hpp"
 #include "event_to_string.hpp"
+#include "graph_cache.hpp"
 #include "handle_event.hpp"
 #include "i18n.hpp"
 #include "warnings.hpp"
@@ -39,6 +44,7 @@ PATCHAGE_DISABLE_FMT_WARNINGS
 #include <fmt/core.h>
 PATCHAGE_RESTORE_WARNINGS
 
+#include <gdk/gdk.h>
 #include <glib-object.h>
 #include <glib.h>
 #include <glibmm/fileutils.h>
@@ -56,7 +62,9 @@ PATCHAGE_RESTORE_WARNINGS
 #include <gtkmm/checkbutton.h>
 #include <gtkmm/checkmenuitem.h>
 #include <gtkmm/combobox.h>
+#include <gtkmm/comboboxtext.h>
 #include <gtkmm/dialog.h>
+#include <gtkmm/entry.h>
 #include <gtkmm/enums.h>
 #include <gtkmm/filechooser.h>
 #include <gtkmm/filechooserdialog.h>
@@ -91,10 +99,18 @@ PATCHAGE_RESTORE_WARNINGS
 #include <cstdint>
 #include <cstdlib>
 #include <functional>
+#include <iterator>
 #include <map>
+#include <memory>
 #include <optional>
+#include <string>
 #include <utility>
 #include <variant>
+#include <vector>
+
+#ifdef __APPLE__
+#  include "binary_location.h"
+#endif
 
 #ifdef PATCHAGE_GTK_OSX
 
@@ -235,8 +251,8 @@ update_edge_color(GanvEdge* edge, void* data)
 #define INIT_WIDGET(x) x(_xml, (#x) + 1)
 
 Patchage::Patchage(Options options)
-  : _xml(UIFile::open("patchage"))
-  , INIT_WIDGET(_about_win)
+  : _profile{options.profile_startup, "load UI"}
+  , _xml(UIFile::open("main_win"))
   , INIT_WIDGET(_main_scrolledwin)
   , INIT_WIDGET(_main_win)
   , INIT_WIDGET(_main_vbox)
@@ -245,6 +261,8 @@ Patchage::Patchage(Options options)
   , INIT_WIDGET(_menu_alsa_disconnect)
   , INIT_WIDGET(_menu_file_quit)
   , INIT_WIDGET(_menu_export_image)
+  , INIT_WIDGET(_menu_save_snapshot)
+  , INIT_WIDGET(_menu_restore_snapshot)
   , INIT_WIDGET(_menu_help_about)
   , INIT_WIDGET(_menu_jack_connect)
   , INIT_WIDGET(_menu_jack_disconnect)
@@ -273,15 +291,18 @@ Patchage::Patchage(Options options)
   , INIT_WIDGET(_status_text)
   , _conf([this](const Setting& setting) { on_conf_change(setting); })
   , _log(_status_text)
-  , _canvas(new Canvas{_log, _action_sink, 1600 * 2, 1200 * 2})
-  , _drivers(_log, [this](const Event& event) { on_driver_event(event); })
-  , _reactor(_conf, _drivers, *_canvas, _log)
+  , _canvas(create_canvas())
+  , _drivers(_log,
+             [this](Driver::Events&& events) {
+               on_driver_event(std::move(events));
+             })
+  , _reactor(_conf, _drivers, *_canvas, _metadata, _graph, _log)
   , _action_sink([this](const Action& action) { _reactor(action); })
+  , _control(_log, _graph, _metadata, _action_sink)
+  , _publisher(_log)
   , _options{options}
 {
   Glib::set_application_name("Patchage");
-  _about_win->property_program_name()   = "Patchage";
-  _about_win->property_logo_icon_name() = "patchage";
   gtk_window_set_default_icon_name("patchage");
 
   // Create list model for buffer size selector
@@ -313,6 +334,10 @@ Patchage::Patchage(Options options)
     sigc::mem_fun(this, &Patchage::on_quit));
   _menu_export_image->signal_activate().connect(
     sigc::mem_fun(this, &Patchage::on_export_image));
+  _menu_save_snapshot->signal_activate().connect(
+    sigc::mem_fun(this, &Patchage::on_save_snapshot));
+  _menu_restore_snapshot->signal_activate().connect(
+    sigc::mem_fun(this, &Patchage::on_restore_snapshot));
   _menu_view_refresh->signal_activate().connect(sigc::bind(
     sigc::mem_fun(this, &Patchage::on_menu_action), Action{action::Refresh{}}));
 
@@ -383,7 +408,9 @@ Patchage::Patchage(Options options)
     static_cast<float>(_canvas->get_default_font_size()));
 
   // Load configuration file (but do not apply it yet, see below)
+  _profile.start("load config");
   _conf.load();
+  _profile.finish();
 
   _legend = new Legend(_conf);
   _legend->signal_color_changed.connect(
@@ -391,23 +418,12 @@ Patchage::Patchage(Options options)
   _legend_alignment->add(*Gtk::manage(_legend));
   _legend->show_all();
 
-  _about_win->set_transient_for(*_main_win);
-
-#ifdef __APPLE__
-  try {
-    _about_win->set_logo(Gdk::Pixbuf::create_from_file(
-      bundle_location() + "/Resources/Patchage.icns"));
-  } catch (const Glib::Exception& e) {
-    _log.error(fmt::format("Failed to set logo ({})", std::string(e.what())));
-  }
-#endif
-
   // Enable JACK menu items if driver is present
   if (_drivers.jack()) {
     _menu_jack_connect->signal_activate().connect(sigc::bind(
-      sigc::mem_fun(_drivers.jack().get(), &AudioDriver::attach), true));
-    _menu_jack_disconnect->signal_activate().connect(
-      sigc::mem_fun(_drivers.jack().get(), &AudioDriver::detach));
+      sigc::mem_fun(this, &Patchage::attach_driver), ClientType::jack, true));
+    _menu_jack_disconnect->signal_activate().connect(sigc::bind(
+      sigc::mem_fun(_drivers, &Drivers::detach), ClientType::jack));
   } else {
     _menu_jack_connect->set_sensitive(false);
     _menu_jack_disconnect->set_sensitive(false);
@@ -415,10 +431,10 @@ Patchage::Patchage(Options options)
 
   // Enable ALSA menu items if driver is present
   if (_drivers.alsa()) {
-    _menu_alsa_connect->signal_activate().connect(
-      sigc::bind(sigc::mem_fun(_drivers.alsa().get(), &Driver::attach), false));
-    _menu_alsa_disconnect->signal_activate().connect(
-      sigc::mem_fun(_drivers.alsa().get(), &Driver::detach));
+    _menu_alsa_connect->signal_activate().connect(sigc::bind(
+      sigc::mem_fun(this, &Patchage::attach_driver), ClientType::alsa, false));
+    _menu_alsa_disconnect->signal_activate().connect(sigc::bind(
+      sigc::mem_fun(_drivers, &Drivers::detach), ClientType::alsa));
   } else {
     _menu_alsa_connect->set_sensitive(false);
     _menu_alsa_disconnect->set_sensitive(false);
@@ -451,6 +467,12 @@ Patchage::Patchage(Options options)
   // Apply all configuration settings to ensure the GUI is synced
   _conf.each([this](const Setting& setting) { on_conf_change(setting); });
 
+  // Show the last known graph until the drivers are attached
+  show_cached_graph();
+
+  // Attach once the main loop is running, whether or not the window is shown
+  Glib::signal_idle().connect(sigc::mem_fun(this, &Patchage::attach_callback));
+
   // Set up an idle callback to process events and update the GUI if necessary
   Glib::signal_timeout().connect(sigc::mem_fun(this, &Patchage::idle_callback),
                                  100);
@@ -458,37 +480,148 @@ Patchage::Patchage(Options options)
 
 Patchage::~Patchage()
 {
-  _about_win.destroy();
+  delete _about_win;
   _xml.reset();
 }
 
+std::unique_ptr<Canvas>
+Patchage::create_canvas()
+{
+  _profile.finish();
+  _profile.start("create canvas");
+
+  std::unique_ptr<Canvas> canvas{
+    new Canvas{_log, _action_sink, 1600 * 2, 1200 * 2}};
+
+  _profile.finish();
+  return canvas;
+}
+
+Gtk::AboutDialog&
+Patchage::about_dialog()
+{
+  if (!_about_win) {
+    // Build the dialog on first use, since it's rarely needed
+    UIFile::add(_xml, "about_win");
+    _xml->get_widget("about_win", _about_win);
+
+    _about_win->property_program_name()   = "Patchage";
+    _about_win->property_logo_icon_name() = "patchage";
+    _about_win->set_transient_for(*_main_win);
+
+#ifdef __APPLE__
+    try {
+      _about_win->set_logo(Gdk::Pixbuf::create_from_file(
+        bundle_location() + "/Resources/Patchage.icns"));
+    } catch (const Glib::Exception& e) {
+      _log.error(
+        fmt::format("Failed to set logo ({})", std::string(e.what())));
+    }
+#endif
+  }
+
+  return *_about_win;
+}
+
 void
 Patchage::attach()
 {
-  if (_drivers.jack() && _options.jack_driver_autoattach) {
-    _drivers.jack()->attach(true);
+  std::vector<ClientType> types;
+  if (_options.jack_driver_autoattach) {
+    types.push_back(ClientType::jack);
   }
 
-  if (_drivers.alsa() && _options.alsa_driver_autoattach) {
-    _drivers.alsa()->attach(false);
+  if (_options.alsa_driver_autoattach) {
+    types.push_back(ClientType::alsa);
   }
 
-  process_events();
+  _publisher.open(GraphPublisher::default_name());
+
+  // Attach in the background, since starting JACK can take a while (this task
+  // is counted from the start, so nothing is finished until it is done)
+  _drivers.start_attach(
+    std::move(types), true, [this] { on_drivers_done(); });
+}
+
+void
+Patchage::attach_driver(const ClientType type, const bool launch_daemon)
+{
+  _drivers.start_attach({type}, launch_daemon, {});
+}
+
+void
+Patchage::finish_attach()
+{
   update_toolbar();
+
+  // Drivers have loaded everything, so anything unconfirmed is gone
+  _canvas->remove_stale();
+
+  _control.listen(ControlServer::default_path());
+  _menu_view_messages->set_active(_conf.get<setting::MessagesVisible>());
+  _attach = false;
+  _profile.finish();
+
+  if (_options.profile_startup) {
+    // Draw the attached graph immediately rather than later in the main loop
+    _profile.start("first full draw");
+    gdk_window_process_all_updates();
+    _profile.end();
+  }
+}
+
+void
+Patchage::show_cached_graph()
+{
+  std::vector<Event> events;
+  if (!load_graph_cache(_conf.graph_cache_path(), events)) {
+    return;
+  }
+
+  // Use a separate model so the cache never affects the real one
+  Metadata metadata;
+  Graph    graph;
+  for (const auto& event : events) {
+    handle_event(_conf, metadata, graph, *_canvas, _log, event);
+  }
+
+  _canvas->mark_stale();
+}
+
+bool
+Patchage::attach_callback()
+{
+  _profile.start("attach drivers");
+  attach();
+  return false;
 }
 
 bool
 Patchage::idle_callback()
 {
-  // Initial run, attach
+  // Process any events from drivers
+  process_events();
+
+  // Finish the initial attach once it and the refresh it causes are done
   if (_attach) {
-    attach();
-    _menu_view_messages->set_active(_conf.get<setting::MessagesVisible>());
-    _attach = false;
+    if (_pending_tasks) {
+      return true;
+    }
+
+    finish_attach();
   }
 
-  // Process any events from drivers
-  process_events();
+  // Handle any commands from scripts
+  _control.poll();
+
+  // Move the ports of any clients that have been split or joined
+  _canvas->regroup_clients(_conf, _metadata);
+
+  // Undo any connection changes that the drivers never confirmed
+  _canvas->expire_changes();
+
+  // Update level meters
+  update_monitors();
 
   // Update load every 5 idle callbacks
   static int count = 0;
@@ -513,7 +646,10 @@ Patchage::update_toolbar()
   if (_drivers.jack() && _drivers.jack()->is_attached()) {
     const auto buffer_size = _drivers.jack()->buffer_size();
     const auto sample_rate = _drivers.jack()->sample_rate();
-    if (sample_rate != 0) {
+
+    _shown_buffer_size = buffer_size;
+    _shown_sample_rate = sample_rate;
+    if (buffer_size != 0 && sample_rate != 0) {
       const auto sample_rate_khz = sample_rate / 1000.0;
       const auto latency_ms      = buffer_size / sample_rate_khz;
 
@@ -523,13 +659,15 @@ Patchage::update_toolbar()
                                             latency_ms));
 
       _latency_label->set_visible(true);
-      _buf_size_combo->set_active(static_cast<int>(
-        log2f(static_cast<float>(_drivers.jack()->buffer_size())) - 5));
+      _buf_size_combo->set_active(
+        static_cast<int>(log2f(static_cast<float>(buffer_size)) - 5));
       updating = false;
       return;
     }
   }
 
+  _shown_buffer_size = 0U;
+  _shown_sample_rate = 0U;
   _latency_label->set_visible(false);
   updating = false;
 }
@@ -549,11 +687,37 @@ Patchage::update_load()
       _dropouts_label->hide();
       _clear_load_but->hide();
     }
+
+    // Update the toolbar if the buffer size or sample rate has changed
+    if (_drivers.jack()->buffer_size() != _shown_buffer_size ||
+        _drivers.jack()->sample_rate() != _shown_sample_rate) {
+      update_toolbar();
+    }
   }
 
   return true;
 }
 
+void
+Patchage::update_monitors()
+{
+  std::vector<PortID> stale;
+  for (const auto& id : _canvas->monitored_ports()) {
+    Driver* const     driver   = _drivers.driver(id.type());
+    CanvasPort* const port     = _canvas->find_port(id);
+    const auto        activity = driver ? driver->activity(id) : std::nullopt;
+    if (!port || !activity) {
+      stale.push_back(id);
+    } else {
+      port->set_activity(*activity);
+    }
+  }
+
+  for (const auto& id : stale) {
+    _reactor(action::UnmonitorPort{id});
+  }
+}
+
 void
 Patchage::store_window_location()
 {
@@ -590,18 +754,11 @@ Patchage::operator()(const setting::AlsaAttached& setting)
     _menu_alsa_connect->set_sensitive(false);
     _menu_alsa_disconnect->set_sensitive(true);
 
-    if (_drivers.alsa()) {
-      _drivers.alsa()->refresh([this](const Event& event) {
-        handle_event(_conf, _metadata, *_canvas, _log, event);
-      });
-    }
+    // Load everything once all drivers in this batch have been attached
+    _refresh_types.push_back(ClientType::alsa);
   } else {
     _menu_alsa_connect->set_sensitive(true);
     _menu_alsa_disconnect->set_sensitive(false);
-
-    _canvas->remove_ports([](const CanvasPort* port) {
-      return port->type() == PortType::alsa_midi;
-    });
   }
 }
 
@@ -612,21 +769,11 @@ Patchage::operator()(const setting::JackAttached& setting)
     _menu_jack_connect->set_sensitive(false);
     _menu_jack_disconnect->set_sensitive(true);
 
-    if (_drivers.jack()) {
-      _drivers.jack()->refresh([this](const Event& event) {
-        handle_event(_conf, _metadata, *_canvas, _log, event);
-      });
-    }
+    // Load everything once all drivers in this batch have been attached
+    _refresh_types.push_back(ClientType::jack);
   } else {
     _menu_jack_connect->set_sensitive(true);
     _menu_jack_disconnect->set_sensitive(false);
-
-    _canvas->remove_ports([](const CanvasPort* port) {
-      return (port->type() == PortType::jack_audio ||
-              port->type() == PortType::jack_midi ||
-              port->type() == PortType::jack_osc ||
-              port->type() == PortType::jack_cv);
-    });
   }
 }
 
@@ -748,25 +895,75 @@ Patchage::operator()(const setting::Zoom& setting)
 }
 
 void
-Patchage::on_driver_event(const Event& event)
+Patchage::on_driver_event(Driver::Events&& events)
 {
   const std::lock_guard<std::mutex> lock{_events_mutex};
 
-  _driver_events.emplace(event);
+  if (_driver_events.empty()) {
+    _driver_events = std::move(events);
+  } else {
+    _driver_events.insert(_driver_events.end(),
+                          std::make_move_iterator(events.begin()),
+                          std::make_move_iterator(events.end()));
+  }
 }
 
 void
-Patchage::process_events()
+Patchage::on_drivers_done()
 {
   const std::lock_guard<std::mutex> lock{_events_mutex};
 
-  while (!_driver_events.empty()) {
-    const Event& event = _driver_events.front();
+  ++_finished_tasks;
+}
 
+void
+Patchage::process_events()
+{
+  // Show messages logged by driver threads since the last call
+  _log.flush();
+
+  // Have drivers emit the events they gathered from system callbacks
+  _drivers.flush_events();
+
+  // Take all pending events so drivers are not blocked while handling them
+  Driver::Events events;
+  size_t         finished = 0U;
+  {
+    const std::lock_guard<std::mutex> lock{_events_mutex};
+    events.swap(_driver_events);
+    std::swap(finished, _finished_tasks);
+  }
+
+  for (const auto& event : events) {
     _log.info(event_to_string(event));
-    handle_event(_conf, _metadata, *_canvas, _log, event);
+  }
+
+  dispatch_events(events);
+
+  // Tasks emit everything before finishing, so they are done with these
+  _pending_tasks -= finished;
 
-    _driver_events.pop();
+  // Update the shared graph once per batch
+  if (!events.empty()) {
+    _publisher.publish(_metadata, _graph);
+  }
+}
+
+void
+Patchage::dispatch_events(const Driver::Events& events)
+{
+  // Send events to subscribers first, since handling them may cause more
+  _control.publish(events);
+
+  handle_events(
+    _conf, _metadata, _graph, *_canvas, _log, _action_sink, events);
+
+  // Refresh newly attached drivers together in the background
+  if (!_refresh_types.empty()) {
+    std::vector<ClientType> types;
+    types.swap(_refresh_types);
+    ++_pending_tasks;
+    _drivers.start_refresh(std::move(types), [this] { on_drivers_done(); });
   }
 }
 
@@ -787,8 +984,9 @@ Patchage::on_arrange()
 void
 Patchage::on_help_about()
 {
-  _about_win->run();
-  _about_win->hide();
+  Gtk::AboutDialog& dialog = about_dialog();
+  dialog.run();
+  dialog.hide();
 }
 
 void
@@ -811,6 +1009,10 @@ Patchage::save()
   // Zoom can be changed by ganv
   _conf.set<setting::Zoom>(static_cast<float>(_canvas->get_zoom()));
   _conf.save();
+
+  if (!save_graph_cache(_conf.graph_cache_path(), _metadata, _graph)) {
+    _log.warning("Failed to save graph cache");
+  }
 }
 
 void
@@ -822,13 +1024,8 @@ Patchage::quit()
 void
 Patchage::on_quit()
 {
-  if (_drivers.alsa()) {
-    _drivers.alsa()->detach();
-  }
-
-  if (_drivers.jack()) {
-    _drivers.jack()->detach();
-  }
+  _drivers.detach(ClientType::alsa);
+  _drivers.detach(ClientType::jack);
 
   _main_win->hide();
 }
@@ -883,6 +1080,64 @@ Patchage::on_export_image()
   }
 }
 
+std::optional<std::string>
+Patchage::run_snapshot_dialog(const std::string& title, const bool save)
+{
+  Gtk::Dialog dialog(title, *_main_win, true);
+  dialog.add_button(Gtk::Stock::CANCEL, Gtk::RESPONSE_CANCEL);
+  dialog.add_button(save ? Gtk::Stock::SAVE : Gtk::Stock::OPEN,
+                    Gtk::RESPONSE_OK);
+  dialog.set_default_response(Gtk::RESPONSE_OK);
+
+  // Choose from existing snapshots, or enter a new name when saving
+  Gtk::ComboBoxText names(save);
+  for (const auto& name : _conf.snapshot_names()) {
+    names.append(name);
+  }
+
+  if (save) {
+    names.get_entry()->set_activates_default(true);
+  } else {
+    names.set_active(0);
+  }
+
+  dialog.get_vbox()->pack_start(names, false, false, 4);
+  names.show();
+
+  if (dialog.run() != Gtk::RESPONSE_OK) {
+    return {};
+  }
+
+  const std::string name = names.get_active_text();
+  if (!is_snapshot_name(name)) {
+    _log.error(fmt::format(u8"Invalid snapshot name “{}”", name));
+    return {};
+  }
+
+  return name;
+}
+
+void
+Patchage::on_save_snapshot()
+{
+  if (const auto name = run_snapshot_dialog(T("Save Snapshot"), true)) {
+    _reactor(action::SaveSnapshot{*name});
+  }
+}
+
+void
+Patchage::on_restore_snapshot()
+{
+  if (_conf.snapshot_names().empty()) {
+    _log.warning(T("No snapshots have been saved"));
+    return;
+  }
+
+  if (const auto name = run_snapshot_dialog(T("Restore Snapshot"), false)) {
+    _reactor(action::RestoreSnapshot{*name});
+  }
+}
+
 bool
 Patchage::on_scroll(GdkEventScroll*)
 {
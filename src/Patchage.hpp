@@ -7,13 +7,19 @@
 #include "Action.hpp"
 #include "ActionSink.hpp"
 #include "Canvas.hpp"
+#include "ClientType.hpp"
 #include "Configuration.hpp"
+#include "ControlServer.hpp"
+#include "Driver.hpp"
 #include "Drivers.hpp"
 #include "Event.hpp"
+#include "Graph.hpp"
+#include "GraphPublisher.hpp"
 #include "Metadata.hpp"
 #include "Options.hpp"
 #include "Reactor.hpp"
 #include "Setting.hpp"
+#include "StartupProfile.hpp"
 #include "TextViewLog.hpp"
 #include "Widget.hpp"
 
@@ -23,11 +29,13 @@
 #include <gtkmm/treemodelcolumn.h>
 #include <gtkmm/widget.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <optional>
 #include <string>
+#include <vector>
 
 namespace Glib {
 class ustring;
@@ -88,6 +96,9 @@ public:
   void operator()(const setting::Zoom& setting);
 
   void attach();
+  void attach_driver(ClientType type, bool launch_daemon);
+  void finish_attach();
+  void show_cached_graph();
   void save();
   void quit();
 
@@ -109,15 +120,22 @@ protected:
     Gtk::TreeModelColumn<Glib::ustring> label;
   };
 
-  void on_driver_event(const Event& event);
+  void on_driver_event(Driver::Events&& events);
+  void on_drivers_done();
   void process_events();
+  void dispatch_events(const Driver::Events& events);
 
   void on_conf_change(const Setting& setting);
 
+  std::unique_ptr<Canvas> create_canvas();
+  Gtk::AboutDialog&       about_dialog();
+
   void on_arrange();
   void on_help_about();
   void on_quit();
   void on_export_image();
+  void on_save_snapshot();
+  void on_restore_snapshot();
   void on_store_positions();
 
   void on_legend_color_change(PortType           id,
@@ -130,16 +148,22 @@ protected:
 
   void on_menu_action(const Action& action);
 
+  std::optional<std::string> run_snapshot_dialog(const std::string& title,
+                                                 bool               save);
+
+  bool attach_callback();
   bool idle_callback();
   void clear_load();
   bool update_load();
+  void update_monitors();
   void update_toolbar();
 
   void buffer_size_changed();
 
+  StartupProfile             _profile;
   Glib::RefPtr<Gtk::Builder> _xml;
+  Gtk::AboutDialog*          _about_win{nullptr};
 
-  Widget<Gtk::AboutDialog>    _about_win;
   Widget<Gtk::ScrolledWindow> _main_scrolledwin;
   Widget<Gtk::Window>         _main_win;
   Widget<Gtk::VBox>           _main_vbox;
@@ -148,6 +172,8 @@ protected:
   Widget<Gtk::MenuItem>       _menu_alsa_disconnect;
   Widget<Gtk::MenuItem>       _menu_file_quit;
   Widget<Gtk::MenuItem>       _menu_export_image;
+  Widget<Gtk::MenuItem>       _menu_save_snapshot;
+  Widget<Gtk::MenuItem>       _menu_restore_snapshot;
   Widget<Gtk::MenuItem>       _menu_help_about;
   Widget<Gtk::MenuItem>       _menu_jack_connect;
   Widget<Gtk::MenuItem>       _menu_jack_disconnect;
@@ -179,19 +205,27 @@ protected:
   TextViewLog             _log;
   std::unique_ptr<Canvas> _canvas;
   std::mutex              _events_mutex;
-  std::queue<Event>       _driver_events;
+  Driver::Events          _driver_events;
+  size_t                  _finished_tasks{0U}; ///< Finished driver tasks
   BufferSizeColumns       _buf_size_columns;
   Legend*                 _legend{nullptr};
   Metadata                _metadata;
+  Graph                   _graph;
   Drivers                 _drivers;
   Reactor                 _reactor;
   ActionSink              _action_sink;
+  ControlServer           _control;
+  GraphPublisher          _publisher;
+  std::vector<ClientType> _refresh_types;
+  size_t                  _pending_tasks{1U}; ///< Unfinished driver tasks
 
   Glib::RefPtr<Gtk::TextTag> _error_tag;
   Glib::RefPtr<Gtk::TextTag> _warning_tag;
 
-  Options _options;
-  bool    _attach{true};
+  Options  _options;
+  bool     _attach{true};
+  uint32_t _shown_buffer_size{0U};
+  uint32_t _shown_sample_rate{0U};
 };
 
 } // namespace patchage
@@ -0,0 +1,20 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PATCHAGE_PORTACTIVITY_HPP
+#define PATCHAGE_PORTACTIVITY_HPP
+
+#include <cstdint>
+
+namespace patchage {
+
+/// Signal activity on a monitored port since it was last measured
+struct PortActivity {
+  float    peak;     ///< Peak absolute signal value
+  float    rms;      ///< Root mean square signal value
+  uint32_t n_events; ///< Number of MIDI events
+};
+
+} // namespace patchage
+
+#endif // PATCHAGE_PORTACTIVITY_HPP
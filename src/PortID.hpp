@@ -171,6 +171,23 @@ struct hash<patchage::PortID::Type> {
   }
 };
 
+template<>
+struct hash<patchage::PortID> {
+  size_t operator()(const patchage::PortID& id) const noexcept
+  {
+    switch (id.type()) {
+    case patchage::PortID::Type::jack:
+      return hash<string>()(id.jack_name());
+    case patchage::PortID::Type::alsa:
+      return hash<unsigned>()((unsigned{id.alsa_client()} << 9U) |
+                              (unsigned{id.alsa_port()} << 1U) |
+                              unsigned{id.alsa_is_input()});
+    }
+
+    return 0U;
+  }
+};
+
 } // namespace std
 
 template<>
@@ -6,24 +6,27 @@
 #include "Action.hpp"
 #include "Canvas.hpp"
 #include "CanvasModule.hpp"
-#include "CanvasPort.hpp"
-#include "ClientType.hpp"
 #include "Configuration.hpp"
+#include "Connection.hpp"
 #include "Driver.hpp"
 #include "Drivers.hpp"
+#include "Graph.hpp"
 #include "ILog.hpp"
+#include "Metadata.hpp"
 #include "PortID.hpp"
 #include "Setting.hpp"
 #include "SignalDirection.hpp"
+#include "Snapshot.hpp"
 #include "warnings.hpp"
 
-#include <ganv/Port.hpp>
-
 PATCHAGE_DISABLE_FMT_WARNINGS
 #include <fmt/core.h>
 PATCHAGE_RESTORE_WARNINGS
 
+#include <string>
+#include <utility>
 #include <variant>
+#include <vector>
 
 namespace patchage {
 
@@ -44,13 +47,17 @@ private:
   Configuration& _conf;
 };
 
-Reactor::Reactor(Configuration& conf,
-                 Drivers&       drivers,
-                 Canvas&        canvas,
-                 ILog&          log)
+Reactor::Reactor(Configuration&  conf,
+                 Drivers&        drivers,
+                 Canvas&         canvas,
+                 const Metadata& metadata,
+                 const Graph&    graph,
+                 ILog&           log)
   : _conf{conf}
   , _drivers{drivers}
   , _canvas{canvas}
+  , _metadata{metadata}
+  , _graph{graph}
   , _log{log}
 {}
 
@@ -61,18 +68,16 @@ Reactor::operator()(const action::ChangeSetting& action)
   std::visit(visitor, action.setting);
 }
 
+void
+Reactor::operator()(const action::ConnectMany& action)
+{
+  _drivers.connect(action.connections);
+}
+
 void
 Reactor::operator()(const action::ConnectPorts& action)
 {
-  if (action.tail.type() == action.head.type()) {
-    if (auto* d = _drivers.driver(action.tail.type())) {
-      d->connect(action.tail, action.head);
-    } else {
-      _log.error(fmt::format("No driver for {}", action.tail.type()));
-    }
-  } else {
-    _log.warning("Unable to connect incompatible port");
-  }
+  (*this)(action::ConnectMany{{Connection{action.tail, action.head}}});
 }
 
 void
@@ -84,35 +89,41 @@ Reactor::operator()(const action::DecreaseFontSize&)
 void
 Reactor::operator()(const action::DisconnectClient& action)
 {
-  if (CanvasModule* mod = find_module(action.client, action.direction)) {
-    for (Ganv::Port* p : *mod) {
-      if (p) {
-        p->disconnect();
-      }
+  // Outputs are always tails and inputs heads, so the side selects a module
+  std::vector<Connection> connections;
+  for (const auto& c : _graph.connections_on(action.client)) {
+    if ((action.direction != SignalDirection::input &&
+         c.tail.client() == action.client) ||
+        (action.direction != SignalDirection::output &&
+         c.head.client() == action.client)) {
+      connections.push_back(c);
     }
   }
+
+  if (!connections.empty()) {
+    (*this)(action::DisconnectMany{std::move(connections)});
+  }
+}
+
+void
+Reactor::operator()(const action::DisconnectMany& action)
+{
+  _drivers.disconnect(action.connections);
 }
 
 void
 Reactor::operator()(const action::DisconnectPort& action)
 {
-  if (CanvasPort* port = find_port(action.port)) {
-    port->disconnect();
+  auto connections = _graph.connections_on(action.port);
+  if (!connections.empty()) {
+    (*this)(action::DisconnectMany{std::move(connections)});
   }
 }
 
 void
 Reactor::operator()(const action::DisconnectPorts& action)
 {
-  if (action.tail.type() == action.head.type()) {
-    if (auto* d = _drivers.driver(action.tail.type())) {
-      d->disconnect(action.tail, action.head);
-    } else {
-      _log.error(fmt::format("No driver available to disconnect ports"));
-    }
-  } else {
-    _log.error("Unable to disconnect incompatible ports");
-  }
+  (*this)(action::DisconnectMany{{Connection{action.tail, action.head}}});
 }
 
 void
@@ -121,6 +132,20 @@ Reactor::operator()(const action::IncreaseFontSize&)
   _conf.set<setting::FontSize>(_conf.get<setting::FontSize>() + 1.0f);
 }
 
+void
+Reactor::operator()(const action::MonitorPort& action)
+{
+  if (auto* d = _drivers.driver(action.port.type())) {
+    if (d->monitor(action.port)) {
+      _canvas.set_monitored(action.port, true);
+    } else {
+      _log.warning(fmt::format("Unable to monitor port \"{}\"", action.port));
+    }
+  } else {
+    _log.error(fmt::format("No driver for {}", action.port.type()));
+  }
+}
+
 void
 Reactor::operator()(const action::MoveModule& action)
 {
@@ -141,18 +166,54 @@ Reactor::operator()(const action::ResetFontSize&)
     static_cast<float>(_canvas.get_default_font_size()));
 }
 
+void
+Reactor::operator()(const action::RestoreSnapshot& action)
+{
+  restore_snapshot(_conf, _metadata, _graph, _drivers, _log, action.name);
+}
+
+void
+Reactor::operator()(const action::SaveSnapshot& action)
+{
+  if (!is_snapshot_name(action.name)) {
+    _log.error(fmt::format(u8"Invalid snapshot name “{}”", action.name));
+    return;
+  }
+
+  const auto path     = _conf.snapshot_path(action.name);
+  const auto snapshot = make_snapshot(_metadata, _graph.connections());
+  if (!write_snapshot(path, snapshot)) {
+    _log.error(fmt::format(u8"Unable to write snapshot “{}”", path));
+    return;
+  }
+
+  _log.info(fmt::format(u8"Saved {} connections to snapshot “{}”",
+                        snapshot.size(),
+                        action.name));
+}
+
 void
 Reactor::operator()(const action::SplitModule& action)
 {
   _conf.set_module_split(module_name(action.client), true);
-  _drivers.refresh();
+  _canvas.schedule_regroup(action.client);
+}
+
+void
+Reactor::operator()(const action::UnmonitorPort& action)
+{
+  if (auto* d = _drivers.driver(action.port.type())) {
+    d->unmonitor(action.port);
+  }
+
+  _canvas.set_monitored(action.port, false);
 }
 
 void
 Reactor::operator()(const action::UnsplitModule& action)
 {
   _conf.set_module_split(module_name(action.client), false);
-  _drivers.refresh();
+  _canvas.schedule_regroup(action.client);
 }
 
 void
@@ -208,10 +269,4 @@ Reactor::find_module(const ClientID& client, const SignalDirection type)
   return _canvas.find_module(client, type);
 }
 
-CanvasPort*
-Reactor::find_port(const PortID& port)
-{
-  return _canvas.find_port(port);
-}
-
 } // namespace patchage
@@ -13,23 +13,25 @@ namespace patchage {
 enum class SignalDirection;
 
 struct ClientID;
-struct PortID;
 
 class Canvas;
 class CanvasModule;
-class CanvasPort;
 class Configuration;
 class Drivers;
+class Graph;
 class ILog;
+class Metadata;
 
 /// Reacts to actions from the user
 class Reactor
 {
 public:
-  explicit Reactor(Configuration& conf,
-                   Drivers&       drivers,
-                   Canvas&        canvas,
-                   ILog&          log);
+  explicit Reactor(Configuration&  conf,
+                   Drivers&        drivers,
+                   Canvas&         canvas,
+                   const Metadata& metadata,
+                   const Graph&    graph,
+                   ILog&           log);
 
   Reactor(const Reactor&)            = delete;
   Reactor& operator=(const Reactor&) = delete;
@@ -40,16 +42,22 @@ public:
   ~Reactor() = default;
 
   void operator()(const action::ChangeSetting& action);
+  void operator()(const action::ConnectMany& action);
   void operator()(const action::ConnectPorts& action);
   void operator()(const action::DecreaseFontSize& action);
   void operator()(const action::DisconnectClient& action);
+  void operator()(const action::DisconnectMany& action);
   void operator()(const action::DisconnectPort& action);
   void operator()(const action::DisconnectPorts& action);
   void operator()(const action::IncreaseFontSize& action);
+  void operator()(const action::MonitorPort& action);
   void operator()(const action::MoveModule& action);
   void operator()(const action::Refresh& action);
   void operator()(const action::ResetFontSize& action);
+  void operator()(const action::RestoreSnapshot& action);
+  void operator()(const action::SaveSnapshot& action);
   void operator()(const action::SplitModule& action);
+  void operator()(const action::UnmonitorPort& action);
   void operator()(const action::UnsplitModule& action);
   void operator()(const action::ZoomFull& action);
   void operator()(const action::ZoomIn& action);
@@ -62,12 +70,13 @@ private:
   std::string module_name(const ClientID& client);
 
   CanvasModule* find_module(const ClientID& client, SignalDirection type);
-  CanvasPort*   find_port(const PortID& port);
 
-  Configuration& _conf;
-  Drivers&       _drivers;
-  Canvas&        _canvas;
-  ILog&          _log;
+  Configuration&  _conf;
+  Drivers&        _drivers;
+  Canvas&         _canvas;
+  const Metadata& _metadata;
+  const Graph&    _graph;
+  ILog&           _log;
 };
 
 } // namespace patchage
@@ -0,0 +1,416 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Snapshot.hpp"
+
+#include "ClientInfo.hpp"
+#include "ClientType.hpp"
+#include "Configuration.hpp"
+#include "Connection.hpp"
+#include "Drivers.hpp"
+#include "Graph.hpp"
+#include "ILog.hpp"
+#include "Metadata.hpp"
+#include "PortID.hpp"
+#include "PortInfo.hpp"
+#include "PortNames.hpp"
+#include "SignalDirection.hpp"
+#include "warnings.hpp"
+
+PATCHAGE_DISABLE_FMT_WARNINGS
+#include <fmt/core.h>
+PATCHAGE_RESTORE_WARNINGS
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace patchage {
+namespace {
+
+/// A key for finding a live port by name and direction
+using PortKey = std::tuple<ClientType, std::string, std::string, bool>;
+
+/// Live ports by name, where ports that share a name are sorted by ID
+using PortIndex = std::map<PortKey, std::vector<PortID>>;
+
+PortKey
+port_key(const SnapshotPort& port, const bool is_input)
+{
+  return {port.type, port.client, port.port, is_input};
+}
+
+bool
+is_input(const PortID& id, const PortInfo& info)
+{
+  return (id.type() == PortID::Type::alsa)
+           ? id.alsa_is_input()
+           : info.direction == SignalDirection::input;
+}
+
+PortIndex
+index_ports(const Metadata& metadata)
+{
+  PortIndex index;
+  metadata.each_port([&](const PortID& id, const PortInfo& info) {
+    if (const auto port = snapshot_port(metadata, id)) {
+      index[port_key(*port, is_input(id, info))].push_back(id);
+    }
+  });
+
+  for (auto& entry : index) {
+    std::sort(entry.second.begin(), entry.second.end());
+  }
+
+  return index;
+}
+
+const char*
+type_name(const ClientType type)
+{
+  switch (type) {
+  case ClientType::jack:
+    return "jack";
+  case ClientType::alsa:
+    return "alsa";
+  }
+
+  return "";
+}
+
+std::optional<ClientType>
+parse_type(const std::string& name)
+{
+  if (name == "jack") {
+    return ClientType::jack;
+  }
+
+  if (name == "alsa") {
+    return ClientType::alsa;
+  }
+
+  return {};
+}
+
+void
+write_string(std::ofstream& os, const std::string& str)
+{
+  os << " \"";
+  for (const char c : str) {
+    if (c == '"' || c == '\\') {
+      os << '\\' << c;
+    } else if (c == '\n') {
+      os << "\\n";
+    } else {
+      os << c;
+    }
+  }
+  os << '"';
+}
+
+void
+write_port(std::ofstream& os, const SnapshotPort& port)
+{
+  write_string(os, port.client);
+  write_string(os, port.port);
+  if (port.index) {
+    os << ' ' << port.index;
+  }
+}
+
+/// Read a quoted string with backslash escapes, return false on error
+bool
+read_string(std::istream& is, std::string& str)
+{
+  is >> std::ws;
+  if (is.get() != '"') {
+    return false;
+  }
+
+  str.clear();
+  for (int c = is.get(); c != '"'; c = is.get()) {
+    if (c == '\\') {
+      c = is.get();
+      c = (c == 'n') ? '\n' : c;
+    }
+
+    if (c == EOF) {
+      return false;
+    }
+
+    str += static_cast<char>(c);
+  }
+
+  return true;
+}
+
+bool
+read_port(std::istream& is, const ClientType type, SnapshotPort& port)
+{
+  port.type = type;
+  if (!read_string(is, port.client) || !read_string(is, port.port)) {
+    return false;
+  }
+
+  // Read the index if present, which is only written when it isn't zero
+  is >> std::ws;
+  port.index = 0U;
+  return !isdigit(is.peek()) || (is >> port.index);
+}
+
+} // namespace
+
+bool
+is_snapshot_name(const std::string& name)
+{
+  // Names are used as file names in the snapshot directory
+  const auto is_invalid = [](const char c) {
+    return c == '/' || c == '\\' || iscntrl(static_cast<unsigned char>(c));
+  };
+
+  return !name.empty() && name.front() != '.' &&
+         std::none_of(name.begin(), name.end(), is_invalid);
+}
+
+std::optional<SnapshotPort>
+snapshot_port(const Metadata& metadata, const PortID& id)
+{
+  switch (id.type()) {
+  case PortID::Type::jack: {
+    const PortNames names{id};
+    return SnapshotPort{ClientType::jack, names.client(), names.port()};
+  }
+
+  case PortID::Type::alsa: {
+    // ALSA IDs change between sessions, so use the names from the metadata
+    const auto client_info = metadata.client(id.client());
+    const auto port_info   = metadata.port(id);
+    if (client_info && port_info) {
+      return SnapshotPort{
+        ClientType::alsa, client_info->label, port_info->label};
+    }
+    break;
+  }
+  }
+
+  return {};
+}
+
+Snapshot
+make_snapshot(const Metadata& metadata, const std::vector<Connection>& current)
+{
+  const PortIndex index = index_ports(metadata);
+
+  // Name a port, and number it if other ports have the same names
+  const auto name = [&](const PortID& id, const bool input) {
+    auto port = snapshot_port(metadata, id);
+    if (port) {
+      const auto& ids = index.at(port_key(*port, input));
+      port->index     = static_cast<unsigned>(
+        std::find(ids.begin(), ids.end(), id) - ids.begin());
+    }
+
+    return port;
+  };
+
+  Snapshot snapshot;
+  for (const auto& connection : current) {
+    const auto tail = name(connection.tail, false);
+    const auto head = name(connection.head, true);
+    if (tail && head) {
+      snapshot.push_back({*tail, *head});
+    }
+  }
+
+  return snapshot;
+}
+
+SnapshotDiff
+diff_snapshot(const Metadata&                metadata,
+              const std::vector<Connection>& current,
+              const Snapshot&                snapshot)
+{
+  const PortIndex index = index_ports(metadata);
+
+  // Find the live port for a snapshot port, if it still exists
+  const auto find = [&](const SnapshotPort& port,
+                        const bool          input) -> std::optional<PortID> {
+    const auto i = index.find(port_key(port, input));
+    if (i != index.end() && port.index < i->second.size()) {
+      return i->second[port.index];
+    }
+
+    return {};
+  };
+
+  // Resolve the snapshot to connections between live ports
+  SnapshotDiff                           diff;
+  std::set<Connection>                   wanted;
+  std::set<std::pair<PortKey, unsigned>> unmatched;
+
+  // Report each missing port only once
+  const auto missing = [&](const SnapshotPort& port, const bool input) {
+    if (unmatched.emplace(port_key(port, input), port.index).second) {
+      diff.unmatched.push_back(port);
+    }
+  };
+
+  for (const auto& connection : snapshot) {
+    const auto tail = find(connection.tail, false);
+    const auto head = find(connection.head, true);
+
+    if (!tail) {
+      missing(connection.tail, false);
+    }
+
+    if (!head) {
+      missing(connection.head, true);
+    }
+
+    if (tail && head) {
+      wanted.insert(Connection{*tail, *head});
+    }
+  }
+
+  // Make only the connections that differ from the live graph
+  const std::set<Connection> live(current.begin(), current.end());
+
+  std::set_difference(wanted.begin(),
+                      wanted.end(),
+                      live.begin(),
+                      live.end(),
+                      std::back_inserter(diff.connect));
+
+  std::set_difference(live.begin(),
+                      live.end(),
+                      wanted.begin(),
+                      wanted.end(),
+                      std::back_inserter(diff.disconnect));
+
+  return diff;
+}
+
+bool
+write_snapshot(const std::string& path, const Snapshot& snapshot)
+{
+  std::error_code ec;
+  const auto      dir = std::filesystem::path{path}.parent_path();
+  if (!dir.empty()) {
+    std::filesystem::create_directories(dir, ec);
+  }
+
+  std::ofstream file{path, std::ios::out};
+  if (!file.good()) {
+    return false;
+  }
+
+  for (const auto& connection : snapshot) {
+    file << "connection " << type_name(connection.tail.type);
+    write_port(file, connection.tail);
+    write_port(file, connection.head);
+    file << "\n";
+  }
+
+  file.close();
+  return !file.fail();
+}
+
+std::optional<Snapshot>
+read_snapshot(const std::string& path)
+{
+  std::ifstream file{path, std::ios::in};
+  if (!file.good()) {
+    return {};
+  }
+
+  Snapshot    snapshot;
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream is{line};
+    std::string        key;
+    std::string        type_str;
+    if (!(is >> key)) {
+      continue; // Blank line
+    }
+
+    is >> type_str;
+
+    const auto         type = parse_type(type_str);
+    SnapshotConnection connection;
+    if (key != "connection" || !type ||
+        !read_port(is, *type, connection.tail) ||
+        !read_port(is, *type, connection.head)) {
+      std::cerr << "warning: bad snapshot line `" << line << "'\n";
+      continue;
+    }
+
+    snapshot.push_back(std::move(connection));
+  }
+
+  return snapshot;
+}
+
+bool
+restore_snapshot(const Configuration& conf,
+                 const Metadata&      metadata,
+                 const Graph&         graph,
+                 Drivers&             drivers,
+                 ILog&                log,
+                 const std::string&   name)
+{
+  if (!is_snapshot_name(name)) {
+    log.error(fmt::format(u8"Invalid snapshot name “{}”", name));
+    return false;
+  }
+
+  const auto path     = conf.snapshot_path(name);
+  const auto snapshot = read_snapshot(path);
+  if (!snapshot) {
+    log.error(fmt::format(u8"Unable to read snapshot “{}”", path));
+    return false;
+  }
+
+  const auto diff = diff_snapshot(metadata, graph.connections(), *snapshot);
+  if (!diff.unmatched.empty()) {
+    std::string names;
+    for (const auto& port : diff.unmatched) {
+      names += fmt::format(u8"{}“{}:{}”",
+                           names.empty() ? "" : ", ",
+                           port.client,
+                           port.port);
+    }
+
+    log.warning(fmt::format(u8"Snapshot “{}” has {} missing ports: {}",
+                            name,
+                            diff.unmatched.size(),
+                            names));
+  }
+
+  if (!diff.disconnect.empty()) {
+    drivers.disconnect(diff.disconnect);
+  }
+
+  if (!diff.connect.empty()) {
+    drivers.connect(diff.connect);
+  }
+
+  log.info(fmt::format(u8"Restored snapshot “{}” ({} added, {} removed)",
+                       name,
+                       diff.connect.size(),
+                       diff.disconnect.size()));
+  return true;
+}
+
+} // namespace patchage
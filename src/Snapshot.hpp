@@ -0,0 +1,90 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PATCHAGE_SNAPSHOT_HPP
+#define PATCHAGE_SNAPSHOT_HPP
+
+#include "ClientType.hpp"
+#include "Connection.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace patchage {
+
+struct PortID;
+
+class Configuration;
+class Drivers;
+class Graph;
+class ILog;
+class Metadata;
+
+/// A port in a snapshot, named so that it can be found in later sessions
+struct SnapshotPort {
+  ClientType  type;     ///< System that hosts the port
+  std::string client;   ///< Client name
+  std::string port;     ///< Port name, without the client name
+  unsigned    index{0}; ///< Index among ports with the same names, by ID
+};
+
+/// A connection in a snapshot
+struct SnapshotConnection {
+  SnapshotPort tail;
+  SnapshotPort head;
+};
+
+/// A saved set of connections that can be restored later
+using Snapshot = std::vector<SnapshotConnection>;
+
+/// The changes required to make the current connections match a snapshot
+struct SnapshotDiff {
+  std::vector<Connection>   connect;    ///< Connections to make
+  std::vector<Connection>   disconnect; ///< Connections to remove
+  std::vector<SnapshotPort> unmatched;  ///< Ports that no longer exist
+};
+
+/// Return true if a name can be used for a snapshot file
+bool
+is_snapshot_name(const std::string& name);
+
+/// Return the snapshot name of a port, or nothing if it is unknown
+std::optional<SnapshotPort>
+snapshot_port(const Metadata& metadata, const PortID& id);
+
+/// Return a snapshot of the given connections
+Snapshot
+make_snapshot(const Metadata& metadata, const std::vector<Connection>& current);
+
+/// Return the changes required to get from `current` to `snapshot`
+SnapshotDiff
+diff_snapshot(const Metadata&                metadata,
+              const std::vector<Connection>& current,
+              const Snapshot&                snapshot);
+
+/// Write a snapshot to a file, return true on success
+bool
+write_snapshot(const std::string& path, const Snapshot& snapshot);
+
+/// Read a snapshot from a file
+std::optional<Snapshot>
+read_snapshot(const std::string& path);
+
+/**
+   Restore a saved snapshot.
+
+   The changes required to make the graph match the snapshot are queued with
+   the drivers.  Return false if the snapshot couldn't be read.
+*/
+bool
+restore_snapshot(const Configuration& conf,
+                 const Metadata&      metadata,
+                 const Graph&         graph,
+                 Drivers&             drivers,
+                 ILog&                log,
+                 const std::string&   name);
+
+} // namespace patchage
+
+#endif // PATCHAGE_SNAPSHOT_HPP
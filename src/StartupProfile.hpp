@@ -0,0 +1,79 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PATCHAGE_STARTUPPROFILE_HPP
+#define PATCHAGE_STARTUPPROFILE_HPP
+
+#include "warnings.hpp"
+
+PATCHAGE_DISABLE_FMT_WARNINGS
+#include <fmt/core.h>
+PATCHAGE_RESTORE_WARNINGS
+
+#include <chrono>
+#include <iostream>
+
+namespace patchage {
+
+/**
+   Timer for the phases of startup.
+
+   If enabled, the time each phase took is printed to stderr when it
+   finishes, followed by the total time since the start when profiling ends.
+*/
+class StartupProfile
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /// Start profiling, and timing the first phase
+  StartupProfile(const bool enabled, const char* const first_phase)
+    : _enabled{enabled}
+    , _start{Clock::now()}
+    , _phase_start{_start}
+    , _phase{first_phase}
+  {}
+
+  /// Start timing a phase
+  void start(const char* const phase)
+  {
+    _phase       = phase;
+    _phase_start = Clock::now();
+  }
+
+  /// Finish timing the current phase and print how long it took
+  void finish()
+  {
+    if (_phase) {
+      print(_phase, Clock::now() - _phase_start);
+      _phase = nullptr;
+    }
+  }
+
+  /// Finish profiling and print the total time since the start
+  void end()
+  {
+    finish();
+    print("total", Clock::now() - _start);
+    _enabled = false;
+  }
+
+private:
+  void print(const char* const name, const Clock::duration duration) const
+  {
+    if (_enabled) {
+      const std::chrono::duration<double, std::milli> ms{duration};
+      std::cerr << fmt::format(
+        "startup: {:<16} {:9.3f} ms\n", name, ms.count());
+    }
+  }
+
+  bool              _enabled;
+  Clock::time_point _start;
+  Clock::time_point _phase_start;
+  const char*       _phase;
+};
+
+} // namespace patchage
+
+#endif // PATCHAGE_STARTUPPROFILE_HPP
@@ -0,0 +1,42 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "StreamLog.hpp"
+
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace patchage {
+
+StreamLog::StreamLog(std::string program)
+  : _program{std::move(program)}
+{}
+
+void
+StreamLog::info(const std::string& msg)
+{
+  write("", msg);
+}
+
+void
+StreamLog::warning(const std::string& msg)
+{
+  write("warning: ", msg);
+}
+
+void
+StreamLog::error(const std::string& msg)
+{
+  write("error: ", msg);
+}
+
+void
+StreamLog::write(const char* const prefix, const std::string& msg)
+{
+  const std::lock_guard<std::mutex> lock{_mutex};
+  std::cerr << _program << ": " << prefix << msg << "\n";
+}
+
+} // namespace patchage
@@ -0,0 +1,33 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PATCHAGE_STREAMLOG_HPP
+#define PATCHAGE_STREAMLOG_HPP
+
+#include "ILog.hpp"
+
+#include <mutex>
+#include <string>
+
+namespace patchage {
+
+/// Log that writes to standard error, from any thread
+class StreamLog : public ILog
+{
+public:
+  explicit StreamLog(std::string program);
+
+  void info(const std::string& msg) override;
+  void warning(const std::string& msg) override;
+  void error(const std::string& msg) override;
+
+private:
+  void write(const char* prefix, const std::string& msg);
+
+  std::string _program;
+  std::mutex  _mutex;
+};
+
+} // namespace patchage
+
+#endif // PATCHAGE_STREAMLOG_HPP
@@ -15,7 +15,11 @@
 #include <gtkmm/texttagtable.h>
 #include <gtkmm/textview.h>
 
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace patchage {
 
@@ -23,6 +27,7 @@ TextViewLog::TextViewLog(Widget<Gtk::TextView>& text_view)
   : _error_tag{Gtk::TextTag::create()}
   , _warning_tag{Gtk::TextTag::create()}
   , _text_view{text_view}
+  , _gui_thread{std::this_thread::get_id()}
 {
   for (int s = Gtk::STATE_NORMAL; s <= Gtk::STATE_INSENSITIVE; ++s) {
     _text_view->modify_base(static_cast<Gtk::StateType>(s),
@@ -46,24 +51,65 @@ TextViewLog::TextViewLog(Widget<Gtk::TextView>& text_view)
 void
 TextViewLog::info(const std::string& msg)
 {
-  const Glib::RefPtr<Gtk::TextBuffer> buffer = _text_view->get_buffer();
-  buffer->insert(buffer->end(), std::string("\n") + msg);
-  _text_view->scroll_to_mark(buffer->get_insert(), 0);
+  write(Level::info, msg);
 }
 
 void
 TextViewLog::warning(const std::string& msg)
 {
-  const Glib::RefPtr<Gtk::TextBuffer> buffer = _text_view->get_buffer();
-  buffer->insert_with_tag(buffer->end(), std::string("\n") + msg, _warning_tag);
-  _text_view->scroll_to_mark(buffer->get_insert(), 0);
+  write(Level::warning, msg);
 }
 
 void
 TextViewLog::error(const std::string& msg)
+{
+  write(Level::error, msg);
+}
+
+void
+TextViewLog::flush()
+{
+  std::vector<std::pair<Level, std::string>> pending;
+  {
+    const std::lock_guard<std::mutex> lock{_pending_mutex};
+    pending.swap(_pending);
+  }
+
+  for (const auto& message : pending) {
+    append(message.first, message.second);
+  }
+}
+
+void
+TextViewLog::write(const Level level, const std::string& msg)
+{
+  if (std::this_thread::get_id() != _gui_thread) {
+    const std::lock_guard<std::mutex> lock{_pending_mutex};
+    _pending.emplace_back(level, msg);
+    return;
+  }
+
+  append(level, msg);
+}
+
+void
+TextViewLog::append(const Level level, const std::string& msg)
 {
   const Glib::RefPtr<Gtk::TextBuffer> buffer = _text_view->get_buffer();
-  buffer->insert_with_tag(buffer->end(), std::string("\n") + msg, _error_tag);
+  const std::string                   line   = std::string("\n") + msg;
+
+  switch (level) {
+  case Level::info:
+    buffer->insert(buffer->end(), line);
+    break;
+  case Level::warning:
+    buffer->insert_with_tag(buffer->end(), line, _warning_tag);
+    break;
+  case Level::error:
+    buffer->insert_with_tag(buffer->end(), line, _error_tag);
+    break;
+  }
+
   _text_view->scroll_to_mark(buffer->get_insert(), 0);
 }
 
@@ -9,7 +9,11 @@
 #include <glibmm/refptr.h>
 #include <gtkmm/texttag.h>
 
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace Gtk {
 class TextView;
@@ -20,7 +24,12 @@ namespace patchage {
 template<typename W>
 class Widget;
 
-/// Log that writes colored messages to a Gtk TextView
+/**
+   Log that writes colored messages to a Gtk TextView.
+
+   Messages may be logged from any thread, but those from threads other than
+   the one that created the log are only shown when flush() is called.
+*/
 class TextViewLog : public ILog
 {
 public:
@@ -38,15 +47,27 @@ public:
   void error(const std::string& msg) override;
   void warning(const std::string& msg) override;
 
+  /// Show any messages that were logged from other threads
+  void flush();
+
   int min_height() const;
 
   const Widget<Gtk::TextView>& text_view() const { return _text_view; }
   Widget<Gtk::TextView>&       text_view() { return _text_view; }
 
 private:
+  enum class Level { info, warning, error };
+
+  void write(Level level, const std::string& msg);
+  void append(Level level, const std::string& msg);
+
   Glib::RefPtr<Gtk::TextTag> _error_tag;
   Glib::RefPtr<Gtk::TextTag> _warning_tag;
   Widget<Gtk::TextView>&     _text_view;
+
+  std::thread::id                            _gui_thread;
+  std::mutex                                 _pending_mutex;
+  std::vector<std::pair<Level, std::string>> _pending;
 };
 
 } // namespace patchage
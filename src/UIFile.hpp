@@ -1,57 +1,57 @@
-// Copyright 2007-2020 David Robillard <d@drobilla.net>
+// Copyright 2007-2026 David Robillard <d@drobilla.net>
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #ifndef PATCHAGE_UIFILE_HPP
 #define PATCHAGE_UIFILE_HPP
 
-#include "patchage_config.h"
-
-#if PATCHAGE_BUNDLED
-#  include "binary_location.h"
-#endif
-
+#include <gio/gio.h>
+#include <glib.h>
 #include <glibmm/refptr.h>
+#include <glibmm/ustring.h>
 #include <gtkmm/builder.h>
 
-#include <iostream>
 #include <stdexcept>
 #include <string>
 
 namespace patchage {
 
+/**
+   The UI description, which is compiled into the program as a resource.
+
+   Objects are built individually, so that secondary windows only cost
+   anything when they are first used.
+*/
 class UIFile
 {
 public:
-  static bool is_readable(const std::string& filename)
+  /// Return a new builder with a top-level object and its children
+  static Glib::RefPtr<Gtk::Builder> open(const Glib::ustring& object_id)
   {
-    std::ifstream fs(filename.c_str());
-    const bool    fail = fs.fail();
-    fs.close();
-    return !fail;
+    Glib::RefPtr<Gtk::Builder> builder = Gtk::Builder::create();
+    add(builder, object_id);
+    return builder;
   }
 
-  static Glib::RefPtr<Gtk::Builder> open(const std::string& base_name)
+  /// Add a top-level object and its children to a builder
+  static void add(const Glib::RefPtr<Gtk::Builder>& builder,
+                  const Glib::ustring&              object_id)
   {
-    std::string ui_filename = base_name + ".ui";
-
-#if PATCHAGE_BUNDLED
-    const std::string bundle = bundle_location();
-    if (!bundle.empty()) {
-      const std::string bundle_ui_filename = bundle + "/" + ui_filename;
-      if (is_readable(bundle_ui_filename)) {
-        std::cout << "Loading UI file " << bundle_ui_filename << "\n";
-        return Gtk::Builder::create_from_file(bundle_ui_filename);
-      }
-    }
-#endif
+    static const char* const path = "/net/drobilla/patchage/patchage.ui";
 
-    ui_filename = std::string(PATCHAGE_DATA_DIR) + "/" + ui_filename;
-    if (is_readable(ui_filename)) {
-      std::cout << "Loading UI file " << ui_filename << "\n";
-      return Gtk::Builder::create_from_file(ui_filename);
+    GBytes* const bytes =
+      g_resources_lookup_data(path, G_RESOURCE_LOOKUP_FLAGS_NONE, nullptr);
+    if (!bytes) {
+      throw std::runtime_error(std::string("Unable to find ") + path);
     }
 
-    throw std::runtime_error("Unable to find " + ui_filename);
+    gsize             size = 0U;
+    const auto* const data =
+      static_cast<const char*>(g_bytes_get_data(bytes, &size));
+
+    const std::string buffer{data, size};
+    g_bytes_unref(bytes);
+
+    builder->add_from_string(buffer, object_id);
   }
 };
 
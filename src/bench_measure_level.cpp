@@ -0,0 +1,145 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Benchmark for level metering, which runs in the JACK process callback for
+// every monitored port, so a session with many meters pays for it each cycle
+
+#include "measure_level.hpp"
+#include "warnings.hpp"
+
+PATCHAGE_DISABLE_FMT_WARNINGS
+#include <fmt/core.h>
+PATCHAGE_RESTORE_WARNINGS
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t   n_channels  = 64U;     ///< Number of monitored ports
+constexpr uint32_t sample_rate = 48000U;  ///< Sample rate of the "server"
+constexpr uint32_t seconds     = 10U;     ///< Duration of audio to measure
+
+/// Straightforward scalar measurement to compare against
+patchage::BlockLevel
+measure_level_scalar(const float* const samples, const size_t n_samples)
+{
+  float peak        = 0.0f;
+  float sum_squares = 0.0f;
+  for (size_t i = 0U; i < n_samples; ++i) {
+    peak = std::max(peak, std::fabs(samples[i]));
+    sum_squares += samples[i] * samples[i];
+  }
+
+  return {peak, sum_squares};
+}
+
+/// Generate a different deterministic signal in every channel
+std::vector<std::vector<float>>
+make_channels(const size_t n_samples)
+{
+  std::vector<std::vector<float>> channels(n_channels);
+
+  uint32_t state = 1U;
+  for (size_t c = 0U; c < n_channels; ++c) {
+    channels[c].resize(n_samples);
+    for (size_t i = 0U; i < n_samples; ++i) {
+      state = (state * 1664525U) + 1013904223U;
+
+      const auto noise = static_cast<float>(state >> 8U) / 16777216.0f;
+      const auto phase = static_cast<float>(i * (c + 1U)) / 64.0f;
+
+      channels[c][i] = (0.5f * std::sin(phase)) + (0.25f * (noise - 0.5f));
+    }
+  }
+
+  return channels;
+}
+
+/// Return the average time to measure every channel once, in nanoseconds
+template<class Measure>
+double
+time_cycles(const std::vector<std::vector<float>>& channels,
+            const uint32_t                         n_cycles,
+            Measure                                measure,
+            float&                                 total)
+{
+  const auto start = Clock::now();
+  for (uint32_t i = 0U; i < n_cycles; ++i) {
+    for (const auto& channel : channels) {
+      const auto level = measure(channel.data(), channel.size());
+
+      // Use the results so the measurement can't be optimized out
+      total += level.peak + level.sum_squares;
+    }
+  }
+
+  const auto elapsed = Clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() /
+         static_cast<double>(n_cycles);
+}
+
+} // namespace
+
+int
+main()
+{
+  int   status = 0;
+  float total  = 0.0f;
+
+  fmt::print("{} channels at {} Hz, {} seconds of audio\n\n",
+             n_channels,
+             sample_rate,
+             seconds);
+
+  fmt::print("{:>6} {:>12} {:>12} {:>8} {:>8}\n",
+             "Frames",
+             "Scalar (ns)",
+             "Vector (ns)",
+             "Speedup",
+             "Load (%)");
+
+  for (const size_t n_frames : {64U, 128U, 256U, 512U, 1024U, 2048U}) {
+    const auto channels = make_channels(n_frames);
+    const auto n_cycles =
+      static_cast<uint32_t>(sample_rate * seconds / n_frames);
+
+    // Check that both versions agree before timing them
+    for (const auto& channel : channels) {
+      const auto expected = measure_level_scalar(channel.data(), n_frames);
+      const auto actual = patchage::measure_level(channel.data(), n_frames);
+      if (actual.peak != expected.peak ||
+          std::fabs(actual.sum_squares - expected.sum_squares) >
+            1.0e-4f * expected.sum_squares) {
+        fmt::print("Level mismatch with {} frames\n", n_frames);
+        status = 1;
+      }
+    }
+
+    const double scalar_ns =
+      time_cycles(channels, n_cycles, measure_level_scalar, total);
+
+    const double vector_ns =
+      time_cycles(channels, n_cycles, patchage::measure_level, total);
+
+    // Time available in each cycle before the server misses a deadline
+    const double period_ns = 1.0e9 * static_cast<double>(n_frames) /
+                             static_cast<double>(sample_rate);
+
+    fmt::print("{:>6} {:>12.0f} {:>12.0f} {:>8.2f} {:>8.3f}\n",
+               n_frames,
+               scalar_ns,
+               vector_ns,
+               scalar_ns / vector_ns,
+               100.0 * vector_ns / period_ns);
+  }
+
+  fmt::print("\n(checksum {})\n", total);
+  return status;
+}
@@ -0,0 +1,307 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Action.hpp"
+#include "ClientType.hpp"
+#include "Configuration.hpp"
+#include "ControlServer.hpp"
+#include "Driver.hpp"
+#include "Drivers.hpp"
+#include "Event.hpp"
+#include "Graph.hpp"
+#include "GraphPublisher.hpp"
+#include "ILog.hpp"
+#include "Metadata.hpp"
+#include "Options.hpp"
+#include "PortID.hpp"
+#include "Setting.hpp"
+#include "Snapshot.hpp"
+#include "StreamLog.hpp"
+#include "event_to_string.hpp"
+#include "patchage_config.h"
+#include "update_model.hpp"
+
+#include <glib-unix.h>
+#include <glib.h>
+
+#include <csignal>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace patchage {
+namespace {
+
+/**
+   Connection manager without a user interface.
+
+   This keeps the same model of the system as the GUI, and applies the same
+   connection rules, but uses only a GLib main loop so it can run without a
+   display.
+*/
+class Daemon
+{
+public:
+  Daemon(const Options& options, const bool verbose)
+    : _options{options}
+    , _verbose{verbose}
+    , _log{"patchage-daemon"}
+    , _conf{[](const Setting&) {}}
+    , _drivers{_log,
+               [this](Driver::Events&& events) {
+                 queue_events(std::move(events));
+               }}
+    , _control{_log, _graph, _metadata, [this](const Action& action) {
+                 handle_action(action);
+               }}
+    , _publisher{_log}
+  {
+    _conf.load();
+  }
+
+  /// Attach to the system, restore a snapshot if given, and run until killed
+  int run(const std::optional<std::string>& snapshot);
+
+private:
+  static gboolean on_timeout(gpointer data);
+  static gboolean on_signal(gpointer data);
+
+  void handle_action(const Action& action);
+  void queue_events(Driver::Events&& events);
+  void process_events();
+  void handle_events(const Driver::Events& events);
+
+  Options        _options;
+  bool           _verbose;
+  StreamLog      _log;
+  Configuration  _conf;
+  Metadata       _metadata;
+  Graph          _graph;
+  std::mutex     _events_mutex;
+  Driver::Events _events;
+  GMainLoop*     _loop{nullptr};
+  Drivers        _drivers;
+  ControlServer  _control;
+  GraphPublisher _publisher;
+};
+
+int
+Daemon::run(const std::optional<std::string>& snapshot)
+{
+  _publisher.open(GraphPublisher::default_name());
+
+  std::vector<ClientType> types;
+  if (_options.jack_driver_autoattach) {
+    types.push_back(ClientType::jack);
+  }
+
+  if (_options.alsa_driver_autoattach) {
+    types.push_back(ClientType::alsa);
+  }
+
+  // Attach concurrently, since starting JACK can take a while
+  _drivers.attach(types, true);
+
+  // Load the initial graph so that a snapshot can be compared against it
+  process_events();
+  if (snapshot) {
+    if (!restore_snapshot(
+          _conf, _metadata, _graph, _drivers, _log, *snapshot)) {
+      return 1;
+    }
+  }
+
+  _control.listen(ControlServer::default_path());
+
+  _loop = g_main_loop_new(nullptr, FALSE);
+  g_timeout_add(100U, on_timeout, this);
+  g_unix_signal_add(SIGINT, on_signal, this);
+  g_unix_signal_add(SIGTERM, on_signal, this);
+  g_main_loop_run(_loop);
+  g_main_loop_unref(_loop);
+  _loop = nullptr;
+  return 0;
+}
+
+gboolean
+Daemon::on_timeout(const gpointer data)
+{
+  auto* const self = static_cast<Daemon*>(data);
+
+  self->process_events();
+  self->_control.poll();
+  return TRUE;
+}
+
+gboolean
+Daemon::on_signal(const gpointer data)
+{
+  g_main_loop_quit(static_cast<Daemon*>(data)->_loop);
+  return TRUE;
+}
+
+void
+Daemon::handle_action(const Action& action)
+{
+  // Only connection changes make sense without a canvas
+  if (const auto* const c = std::get_if<action::ConnectMany>(&action)) {
+    _drivers.connect(c->connections);
+  } else if (const auto* const d =
+               std::get_if<action::DisconnectMany>(&action)) {
+    _drivers.disconnect(d->connections);
+  }
+}
+
+void
+Daemon::queue_events(Driver::Events&& events)
+{
+  const std::lock_guard<std::mutex> lock{_events_mutex};
+
+  _events.insert(_events.end(),
+                 std::make_move_iterator(events.begin()),
+                 std::make_move_iterator(events.end()));
+}
+
+void
+Daemon::process_events()
+{
+  _drivers.flush_events();
+
+  Driver::Events events;
+  {
+    const std::lock_guard<std::mutex> lock{_events_mutex};
+    events.swap(_events);
+  }
+
+  if (!events.empty()) {
+    handle_events(events);
+    _publisher.publish(_metadata, _graph);
+  }
+}
+
+void
+Daemon::handle_events(const Driver::Events& events)
+{
+  // Send events to subscribers first, since handling them may cause more
+  _control.publish(events);
+
+  std::vector<ClientType> attached;
+  std::vector<PortID>     new_ports;
+  for (const auto& event : events) {
+    if (_verbose) {
+      _log.info(event_to_string(event));
+    }
+
+    if (const auto id = new_port(_metadata, event)) {
+      new_ports.push_back(*id);
+    }
+
+    update_model(_metadata, _graph, event);
+
+    if (const auto* const a = std::get_if<event::DriverAttached>(&event)) {
+      attached.push_back(a->type);
+    }
+  }
+
+  // Load everything from newly attached drivers together
+  if (!attached.empty()) {
+    _drivers.refresh(
+      attached, [this](Driver::Events&& loaded) { handle_events(loaded); });
+  }
+
+  const auto connections =
+    rule_connections(_conf.connect_rules(), _metadata, _graph, new_ports);
+
+  if (!connections.empty()) {
+    _drivers.connect(connections);
+  }
+}
+
+void
+print_usage()
+{
+  std::cout << "Usage: patchage-daemon [OPTION]...\n";
+  std::cout << "Manage JACK and ALSA connections without a display.\n\n";
+  std::cout << "Options:\n";
+  std::cout << "  -h, --help          Display this help and exit\n";
+  std::cout << "  -A, --no-alsa       Do not automatically attach to ALSA\n";
+  std::cout << "  -J, --no-jack       Do not automatically attach to JACK\n";
+  std::cout << "  -r, --restore NAME  Restore the snapshot NAME on startup\n";
+  std::cout << "  -v, --verbose       Print every change to the system\n";
+  std::cout << "  -V, --version       Display version information and exit\n";
+}
+
+void
+print_version()
+{
+  std::cout << "patchage-daemon " PATCHAGE_VERSION << R"(
+Copyright 2007-2026 David Robillard <d@drobilla.net>.
+License GPLv3+: <http://gnu.org/licenses/gpl.html>.
+This is free software: you are free to change and redistribute it.
+There is NO WARRANTY, to the extent permitted by law.
+)";
+}
+
+} // namespace
+} // namespace patchage
+
+int
+main(int argc, char** argv)
+{
+  ++argv;
+  --argc;
+
+  // Parse command line options
+  patchage::Options          options;
+  std::optional<std::string> snapshot;
+  bool                       verbose = false;
+  while (argc > 0) {
+    if (!strcmp(*argv, "-h") || !strcmp(*argv, "--help")) {
+      patchage::print_usage();
+      return 0;
+    }
+
+    if (!strcmp(*argv, "-A") || !strcmp(*argv, "--no-alsa")) {
+      options.alsa_driver_autoattach = false;
+    } else if (!strcmp(*argv, "-J") || !strcmp(*argv, "--no-jack")) {
+      options.jack_driver_autoattach = false;
+    } else if (!strcmp(*argv, "-r") || !strcmp(*argv, "--restore")) {
+      if (argc == 1) {
+        std::cerr << "patchage-daemon: option requires an argument -- '"
+                  << *argv << "'\n";
+        return 1;
+      }
+
+      ++argv;
+      --argc;
+      snapshot = *argv;
+    } else if (!strcmp(*argv, "-v") || !strcmp(*argv, "--verbose")) {
+      verbose = true;
+    } else if (!strcmp(*argv, "-V") || !strcmp(*argv, "--version")) {
+      patchage::print_version();
+      return 0;
+    } else {
+      std::cerr << "patchage-daemon: invalid option -- '" << *argv << "'\n";
+      patchage::print_usage();
+      return 1;
+    }
+
+    ++argv;
+    --argc;
+  }
+
+  try {
+    patchage::Daemon daemon{options, verbose};
+    return daemon.run(snapshot);
+  } catch (std::exception& e) {
+    std::cerr << "patchage-daemon: error: " << e.what() << "\n";
+    return 1;
+  }
+}
@@ -0,0 +1,266 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "decode_event.hpp"
+
+#include "ClientID.hpp"
+#include "ClientInfo.hpp"
+#include "ClientType.hpp"
+#include "Event.hpp"
+#include "PortID.hpp"
+#include "PortInfo.hpp"
+#include "PortType.hpp"
+#include "SignalDirection.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace patchage {
+namespace {
+
+/// Reader for the fields of a single frame, which fails at the end
+class FrameDecoder
+{
+public:
+  FrameDecoder(const char* const data, const size_t size)
+    : _data{data}
+    , _size{size}
+  {}
+
+  bool at_end() const { return _offset == _size; }
+
+  std::optional<Event> event()
+  {
+    const auto tag = u8();
+    if (!tag) {
+      return {};
+    }
+
+    switch (*tag) {
+    case 1U:
+      return Event{event::Cleared{}};
+    case 2U:
+    case 3U:
+      if (auto id = client_id()) {
+        if (auto label = string()) {
+          if (*tag == 2U) {
+            return Event{event::ClientCreated{*id, {*label}}};
+          }
+
+          return Event{event::ClientChanged{*id, {*label}}};
+        }
+      }
+      return {};
+    case 4U:
+      if (auto id = client_id()) {
+        return Event{event::ClientDestroyed{*id}};
+      }
+      return {};
+    case 5U:
+      if (const auto type = client_type()) {
+        return Event{event::DriverAttached{*type}};
+      }
+      return {};
+    case 6U:
+      if (const auto type = client_type()) {
+        return Event{event::DriverDetached{*type}};
+      }
+      return {};
+    case 7U:
+    case 8U:
+      if (auto id = port_id()) {
+        if (auto info = port_info()) {
+          if (*tag == 7U) {
+            return Event{event::PortCreated{*id, *info}};
+          }
+
+          return Event{event::PortChanged{*id, *info}};
+        }
+      }
+      return {};
+    case 9U:
+      if (auto id = port_id()) {
+        return Event{event::PortDestroyed{*id}};
+      }
+      return {};
+    default:
+      break;
+    }
+
+    if (*tag > 13U) {
+      return {};
+    }
+
+    // The remaining events are all a pair of ports
+    auto tail = port_id();
+    auto head = port_id();
+    if (!tail || !head) {
+      return {};
+    }
+
+    switch (*tag) {
+    case 10U:
+      return Event{event::PortsConnected{*tail, *head}};
+    case 11U:
+      return Event{event::PortsDisconnected{*tail, *head}};
+    case 12U:
+      return Event{event::ConnectFailed{*tail, *head}};
+    default:
+      return Event{event::DisconnectFailed{*tail, *head}};
+    }
+  }
+
+  /// Read a 32-bit big-endian integer
+  std::optional<uint32_t> u32()
+  {
+    if (_size - _offset < 4U) {
+      return {};
+    }
+
+    uint32_t value = 0U;
+    for (unsigned i = 0U; i < 4U; ++i) {
+      value = (value << 8U) | static_cast<uint8_t>(_data[_offset++]);
+    }
+
+    return value;
+  }
+
+private:
+  std::optional<uint8_t> u8()
+  {
+    if (_offset >= _size) {
+      return {};
+    }
+
+    return static_cast<uint8_t>(_data[_offset++]);
+  }
+
+  std::optional<std::string> string()
+  {
+    const auto size = u32();
+    if (!size || _size - _offset < *size) {
+      return {};
+    }
+
+    std::string result{_data + _offset, *size};
+    _offset += *size;
+    return result;
+  }
+
+  std::optional<ClientType> client_type()
+  {
+    const auto value = u8();
+    if (!value || *value > static_cast<uint8_t>(ClientType::alsa)) {
+      return {};
+    }
+
+    return static_cast<ClientType>(*value);
+  }
+
+  std::optional<ClientID> client_id()
+  {
+    const auto type = client_type();
+    if (type == ClientType::jack) {
+      auto name = string();
+      if (name && !name->empty()) {
+        return ClientID::jack(std::move(*name));
+      }
+    } else if (type == ClientType::alsa) {
+      if (const auto id = u8()) {
+        return ClientID::alsa(*id);
+      }
+    }
+
+    return {};
+  }
+
+  std::optional<PortID> port_id()
+  {
+    const auto type = client_type();
+    if (type == ClientType::jack) {
+      // Reject names that aren't "client:port", which PortID requires
+      auto         name  = string();
+      const size_t colon = name ? name->find(':') : std::string::npos;
+      if (colon != std::string::npos && colon > 0U &&
+          colon < name->size() - 1U) {
+        return PortID::jack(std::move(*name));
+      }
+    } else if (type == ClientType::alsa) {
+      const auto client   = u8();
+      const auto port     = u8();
+      const auto is_input = u8();
+      if (client && port && is_input) {
+        return PortID::alsa(*client, *port, *is_input != 0U);
+      }
+    }
+
+    return {};
+  }
+
+  std::optional<PortInfo> port_info()
+  {
+    auto       label       = string();
+    const auto type        = u8();
+    const auto direction   = u8();
+    const auto has_order   = u8();
+    const auto order       = u32();
+    const auto is_terminal = u8();
+    if (!label || !type || !direction || !has_order || !order ||
+        !is_terminal || *type > static_cast<uint8_t>(PortType::jack_cv) ||
+        *direction > static_cast<uint8_t>(SignalDirection::duplex)) {
+      return {};
+    }
+
+    return PortInfo{*label,
+                    static_cast<PortType>(*type),
+                    static_cast<SignalDirection>(*direction),
+                    *has_order ? std::optional<int>{static_cast<int>(*order)}
+                               : std::nullopt,
+                    *is_terminal != 0U};
+  }
+
+  const char* _data;
+  size_t      _size;
+  size_t      _offset{0U};
+};
+
+} // namespace
+
+bool
+decode_events(const char* const   data,
+              const size_t        size,
+              std::vector<Event>& events)
+{
+  std::vector<Event> decoded;
+  size_t             offset = 0U;
+  while (offset < size) {
+    // Read the size of the payload
+    FrameDecoder header{data + offset, size - offset};
+    const auto   frame_size = header.u32();
+    if (!frame_size || size - offset - 4U < *frame_size) {
+      return false;
+    }
+
+    // Decode exactly the whole payload as one event
+    FrameDecoder payload{data + offset + 4U, *frame_size};
+    auto         event = payload.event();
+    if (!event || !payload.at_end()) {
+      return false;
+    }
+
+    decoded.push_back(std::move(*event));
+    offset += 4U + *frame_size;
+  }
+
+  events.insert(events.end(),
+                std::make_move_iterator(decoded.begin()),
+                std::make_move_iterator(decoded.end()));
+  return true;
+}
+
+} // namespace patchage
@@ -0,0 +1,25 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PATCHAGE_DECODE_EVENT_HPP
+#define PATCHAGE_DECODE_EVENT_HPP
+
+#include "Event.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace patchage {
+
+/**
+   Read events from binary frames written by encode_event().
+
+   All frames in `data` are appended to `events`.  Returns false, leaving
+   `events` unchanged, if any frame is truncated or invalid.
+*/
+bool
+decode_events(const char* data, size_t size, std::vector<Event>& events);
+
+} // namespace patchage
+
+#endif // PATCHAGE_DECODE_EVENT_HPP
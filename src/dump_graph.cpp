@@ -0,0 +1,291 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dump_graph.hpp"
+
+#include "ClientID.hpp"
+#include "ClientInfo.hpp"
+#include "Event.hpp"
+#include "Graph.hpp"
+#include "Metadata.hpp"
+#include "PortID.hpp"
+#include "PortInfo.hpp"
+#include "PortType.hpp"
+#include "SignalDirection.hpp"
+#include "load_system.hpp"
+#include "update_model.hpp"
+#include "warnings.hpp"
+
+PATCHAGE_DISABLE_FMT_WARNINGS
+#include <fmt/core.h>
+PATCHAGE_RESTORE_WARNINGS
+
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace patchage {
+namespace {
+
+/// Return a stable machine-readable name for a port type
+const char*
+port_type_name(const PortType type)
+{
+  switch (type) {
+  case PortType::jack_audio:
+    return "jack_audio";
+  case PortType::jack_midi:
+    return "jack_midi";
+  case PortType::alsa_midi:
+    return "alsa_midi";
+  case PortType::jack_osc:
+    return "jack_osc";
+  case PortType::jack_cv:
+    return "jack_cv";
+  }
+
+  PATCHAGE_UNREACHABLE();
+}
+
+/// Write a string as a quoted JSON string
+void
+write_json_string(std::ostream& stream, const std::string& str)
+{
+  stream << '"';
+  for (const char c : str) {
+    if (c == '"' || c == '\\') {
+      stream << '\\' << c;
+    } else if (c == '\n') {
+      stream << "\\n";
+    } else if (c == '\t') {
+      stream << "\\t";
+    } else if (static_cast<unsigned char>(c) < 0x20U) {
+      stream << fmt::format("\\u{:04X}", static_cast<unsigned>(c));
+    } else {
+      stream << c;
+    }
+  }
+  stream << '"';
+}
+
+/// Write a string as a quoted Graphviz ID
+void
+write_dot_string(std::ostream& stream, const std::string& str)
+{
+  stream << '"';
+  for (const char c : str) {
+    if (c == '"' || c == '\\') {
+      stream << '\\' << c;
+    } else if (c == '\n') {
+      stream << "\\n";
+    } else {
+      stream << c;
+    }
+  }
+  stream << '"';
+}
+
+/// Write a string as a TSV field with backslash escapes
+void
+write_tsv_string(std::ostream& stream, const std::string& str)
+{
+  for (const char c : str) {
+    if (c == '\\') {
+      stream << "\\\\";
+    } else if (c == '\t') {
+      stream << "\\t";
+    } else if (c == '\n') {
+      stream << "\\n";
+    } else if (c == '\r') {
+      stream << "\\r";
+    } else {
+      stream << c;
+    }
+  }
+}
+
+void
+write_json(std::ostream& stream, const Metadata& metadata, const Graph& graph)
+{
+  const char* separator = "";
+
+  stream << "{\n  \"clients\": [";
+  metadata.each_client([&](const ClientID& id, const ClientInfo& info) {
+    stream << separator << "\n    {\"id\": ";
+    write_json_string(stream, fmt::format("{}", id));
+    stream << ", \"label\": ";
+    write_json_string(stream, info.label);
+    stream << "}";
+    separator = ",";
+  });
+
+  separator = "";
+  stream << "\n  ],\n  \"ports\": [";
+  metadata.each_port([&](const PortID& id, const PortInfo& info) {
+    stream << separator << "\n    {\"id\": ";
+    write_json_string(stream, fmt::format("{}", id));
+    stream << ", \"client\": ";
+    write_json_string(stream, fmt::format("{}", id.client()));
+    stream << ", \"label\": ";
+    write_json_string(stream, info.label);
+    stream << ", \"type\": \"" << port_type_name(info.type) << "\""
+           << ", \"direction\": \"" << info.direction << "\""
+           << ", \"order\": ";
+    if (info.order) {
+      stream << *info.order;
+    } else {
+      stream << "null";
+    }
+    stream << ", \"terminal\": " << (info.is_terminal ? "true" : "false")
+           << "}";
+    separator = ",";
+  });
+
+  separator = "";
+  stream << "\n  ],\n  \"connections\": [";
+  graph.each_connection([&](const PortID& tail, const PortID& head) {
+    stream << separator << "\n    {\"tail\": ";
+    write_json_string(stream, fmt::format("{}", tail));
+    stream << ", \"head\": ";
+    write_json_string(stream, fmt::format("{}", head));
+    stream << "}";
+    separator = ",";
+  });
+
+  stream << "\n  ]\n}\n";
+}
+
+void
+write_dot(std::ostream& stream, const Metadata& metadata, const Graph& graph)
+{
+  stream << "digraph patchage {\n"
+         << "  rankdir=\"LR\";\n"
+         << "  node [shape=\"box\"];\n";
+
+  metadata.each_client([&](const ClientID& id, const ClientInfo& info) {
+    stream << "  subgraph ";
+    write_dot_string(stream, fmt::format("cluster_{}", id));
+    stream << " {\n    label=";
+    write_dot_string(stream, info.label);
+    stream << ";\n";
+
+    for (const auto& port_id : graph.client_ports(id)) {
+      if (const auto port = metadata.port(port_id)) {
+        stream << "    ";
+        write_dot_string(stream, fmt::format("{}", port_id));
+        stream << " [label=";
+        write_dot_string(stream, port->label);
+        stream << "];\n";
+      }
+    }
+
+    stream << "  }\n";
+  });
+
+  graph.each_connection([&](const PortID& tail, const PortID& head) {
+    stream << "  ";
+    write_dot_string(stream, fmt::format("{}", tail));
+    stream << " -> ";
+    write_dot_string(stream, fmt::format("{}", head));
+    stream << ";\n";
+  });
+
+  stream << "}\n";
+}
+
+void
+write_tsv(std::ostream& stream, const Metadata& metadata, const Graph& graph)
+{
+  metadata.each_client([&](const ClientID& id, const ClientInfo& info) {
+    stream << "client\t";
+    write_tsv_string(stream, fmt::format("{}", id));
+    stream << '\t';
+    write_tsv_string(stream, info.label);
+    stream << '\n';
+  });
+
+  metadata.each_port([&](const PortID& id, const PortInfo& info) {
+    stream << "port\t";
+    write_tsv_string(stream, fmt::format("{}", id));
+    stream << '\t';
+    write_tsv_string(stream, fmt::format("{}", id.client()));
+    stream << '\t';
+    write_tsv_string(stream, info.label);
+    stream << '\t' << port_type_name(info.type) << '\t' << info.direction
+           << '\t';
+    if (info.order) {
+      stream << *info.order;
+    }
+    stream << '\t' << (info.is_terminal ? "1" : "0") << '\n';
+  });
+
+  graph.each_connection([&](const PortID& tail, const PortID& head) {
+    stream << "connection\t";
+    write_tsv_string(stream, fmt::format("{}", tail));
+    stream << '\t';
+    write_tsv_string(stream, fmt::format("{}", head));
+    stream << '\n';
+  });
+}
+
+} // namespace
+
+std::optional<DumpFormat>
+parse_dump_format(const std::string& name)
+{
+  if (name == "dot") {
+    return DumpFormat::dot;
+  }
+
+  if (name == "json") {
+    return DumpFormat::json;
+  }
+
+  if (name == "tsv") {
+    return DumpFormat::tsv;
+  }
+
+  return {};
+}
+
+void
+write_graph(std::ostream&    stream,
+            const DumpFormat format,
+            const Metadata&  metadata,
+            const Graph&     graph)
+{
+  switch (format) {
+  case DumpFormat::dot:
+    write_dot(stream, metadata, graph);
+    break;
+  case DumpFormat::json:
+    write_json(stream, metadata, graph);
+    break;
+  case DumpFormat::tsv:
+    write_tsv(stream, metadata, graph);
+    break;
+  }
+}
+
+bool
+dump_graph(std::ostream&    stream,
+           const DumpFormat format,
+           const Options&   options,
+           ILog&            log)
+{
+  std::vector<Event> events;
+  const bool         attached = load_system(options, log, events);
+
+  Metadata metadata;
+  Graph    graph;
+  for (const auto& event : events) {
+    update_model(metadata, graph, event);
+  }
+
+  write_graph(stream, format, metadata, graph);
+  stream.flush();
+  return attached && stream.good();
+}
+
+} // namespace patchage
@@ -0,0 +1,50 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PATCHAGE_DUMP_GRAPH_HPP
+#define PATCHAGE_DUMP_GRAPH_HPP
+
+#include <optional>
+#include <ostream>
+#include <string>
+
+namespace patchage {
+
+class Graph;
+class ILog;
+class Metadata;
+struct Options;
+
+/// Text format for a dump of the graph
+enum class DumpFormat {
+  dot,  ///< Graphviz digraph with a cluster for each client
+  json, ///< Object with "clients", "ports", and "connections" arrays
+  tsv,  ///< One tab-separated record per line, starting with its kind
+};
+
+/// Return the format with the given name, or nothing if it is unknown
+std::optional<DumpFormat>
+parse_dump_format(const std::string& name);
+
+/**
+   Write a graph to a stream.
+
+   Records are written one at a time as the model is traversed, so the
+   document is never built in memory.
+*/
+void
+write_graph(std::ostream&   stream,
+            DumpFormat      format,
+            const Metadata& metadata,
+            const Graph&    graph);
+
+/// Attach to the system, and write its current graph to a stream
+bool
+dump_graph(std::ostream&  stream,
+           DumpFormat     format,
+           const Options& options,
+           ILog&          log);
+
+} // namespace patchage
+
+#endif // PATCHAGE_DUMP_GRAPH_HPP
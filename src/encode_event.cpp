@@ -0,0 +1,212 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "encode_event.hpp"
+
+#include "ClientID.hpp"
+#include "ClientInfo.hpp"
+#include "ClientType.hpp"
+#include "Event.hpp"
+#include "Graph.hpp"
+#include "Metadata.hpp"
+#include "PortID.hpp"
+#include "PortInfo.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <variant>
+
+namespace patchage {
+
+namespace {
+
+class EventEncoder
+{
+public:
+  explicit EventEncoder(std::string& buffer)
+    : _buffer{buffer}
+  {}
+
+  void operator()(const event::Cleared&) { tag(1U); }
+
+  void operator()(const event::ClientCreated& event)
+  {
+    tag(2U);
+    client_id(event.id);
+    string(event.info.label);
+  }
+
+  void operator()(const event::ClientChanged& event)
+  {
+    tag(3U);
+    client_id(event.id);
+    string(event.info.label);
+  }
+
+  void operator()(const event::ClientDestroyed& event)
+  {
+    tag(4U);
+    client_id(event.id);
+  }
+
+  void operator()(const event::DriverAttached& event)
+  {
+    tag(5U);
+    u8(static_cast<uint8_t>(event.type));
+  }
+
+  void operator()(const event::DriverDetached& event)
+  {
+    tag(6U);
+    u8(static_cast<uint8_t>(event.type));
+  }
+
+  void operator()(const event::PortCreated& event)
+  {
+    tag(7U);
+    port_id(event.id);
+    port_info(event.info);
+  }
+
+  void operator()(const event::PortChanged& event)
+  {
+    tag(8U);
+    port_id(event.id);
+    port_info(event.info);
+  }
+
+  void operator()(const event::PortDestroyed& event)
+  {
+    tag(9U);
+    port_id(event.id);
+  }
+
+  void operator()(const event::PortsConnected& event)
+  {
+    tag(10U);
+    port_id(event.tail);
+    port_id(event.head);
+  }
+
+  void operator()(const event::PortsDisconnected& event)
+  {
+    tag(11U);
+    port_id(event.tail);
+    port_id(event.head);
+  }
+
+  void operator()(const event::ConnectFailed& event)
+  {
+    tag(12U);
+    port_id(event.tail);
+    port_id(event.head);
+  }
+
+  void operator()(const event::DisconnectFailed& event)
+  {
+    tag(13U);
+    port_id(event.tail);
+    port_id(event.head);
+  }
+
+private:
+  void tag(const uint8_t value) { u8(value); }
+
+  void u8(const uint8_t value) { _buffer += static_cast<char>(value); }
+
+  void u32(const uint32_t value)
+  {
+    u8(static_cast<uint8_t>(value >> 24U));
+    u8(static_cast<uint8_t>(value >> 16U));
+    u8(static_cast<uint8_t>(value >> 8U));
+    u8(static_cast<uint8_t>(value));
+  }
+
+  void string(const std::string& str)
+  {
+    u32(static_cast<uint32_t>(str.size()));
+    _buffer += str;
+  }
+
+  void client_id(const ClientID& id)
+  {
+    u8(static_cast<uint8_t>(id.type()));
+    switch (id.type()) {
+    case ClientType::jack:
+      string(id.jack_name());
+      break;
+    case ClientType::alsa:
+      u8(id.alsa_id());
+      break;
+    }
+  }
+
+  void port_id(const PortID& id)
+  {
+    u8(static_cast<uint8_t>(id.type()));
+    switch (id.type()) {
+    case PortID::Type::jack:
+      string(id.jack_name());
+      break;
+    case PortID::Type::alsa:
+      u8(id.alsa_client());
+      u8(id.alsa_port());
+      u8(id.alsa_is_input() ? 1U : 0U);
+      break;
+    }
+  }
+
+  void port_info(const PortInfo& info)
+  {
+    string(info.label);
+    u8(static_cast<uint8_t>(info.type));
+    u8(static_cast<uint8_t>(info.direction));
+    u8(info.order ? 1U : 0U);
+    u32(static_cast<uint32_t>(info.order.value_or(0)));
+    u8(info.is_terminal ? 1U : 0U);
+  }
+
+  std::string& _buffer;
+};
+
+} // namespace
+
+void
+encode_event(std::string& buffer, const Event& event)
+{
+  // Reserve space for the size, and fill it in once the payload is written
+  const size_t start = buffer.size();
+  buffer.append(4U, '\0');
+
+  EventEncoder encoder{buffer};
+  std::visit(encoder, event);
+
+  const auto size = static_cast<uint32_t>(buffer.size() - start - 4U);
+  buffer[start]      = static_cast<char>(size >> 24U);
+  buffer[start + 1U] = static_cast<char>(size >> 16U);
+  buffer[start + 2U] = static_cast<char>(size >> 8U);
+  buffer[start + 3U] = static_cast<char>(size);
+}
+
+void
+encode_snapshot(std::string&    buffer,
+                const Metadata& metadata,
+                const Graph&    graph)
+{
+  encode_event(buffer, event::Cleared{});
+
+  metadata.each_client([&](const ClientID& id, const ClientInfo& info) {
+    encode_event(buffer, event::ClientCreated{id, info});
+  });
+
+  metadata.each_port([&](const PortID& id, const PortInfo& info) {
+    encode_event(buffer, event::PortCreated{id, info});
+  });
+
+  graph.each_connection([&](const PortID& tail, const PortID& head) {
+    encode_event(buffer, event::PortsConnected{tail, head});
+  });
+}
+
+} // namespace patchage
@@ -0,0 +1,54 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PATCHAGE_ENCODE_EVENT_HPP
+#define PATCHAGE_ENCODE_EVENT_HPP
+
+#include "Event.hpp"
+
+#include <string>
+
+namespace patchage {
+
+class Graph;
+class Metadata;
+
+/**
+   Append an event to a buffer as a binary frame.
+
+   A frame is a 32-bit payload size, then the payload: a one byte tag for the
+   event type followed by its fields in order.  All integers are big-endian.
+
+   Tags: 1 Cleared, 2 ClientCreated, 3 ClientChanged, 4 ClientDestroyed,
+   5 DriverAttached, 6 DriverDetached, 7 PortCreated, 8 PortChanged,
+   9 PortDestroyed, 10 PortsConnected, 11 PortsDisconnected,
+   12 ConnectFailed, 13 DisconnectFailed.
+
+   Fields are encoded as:
+
+   - string: u32 size, then UTF-8 bytes
+   - ClientType, PortType, SignalDirection: u8 enumerator value
+   - ClientID: u8 type, then a string name for JACK or a u8 ID for ALSA
+   - PortID: u8 type, then a string full name for JACK, or u8 client, u8
+     port, and u8 input flag for ALSA
+   - ClientInfo: string label
+   - PortInfo: string label, u8 type, u8 direction, u8 has order, i32 order,
+     u8 terminal flag
+*/
+void
+encode_event(std::string& buffer, const Event& event);
+
+/**
+   Append frames that describe the current system to a buffer.
+
+   This is a Cleared event, then a ClientCreated for every client, a
+   PortCreated for every port, and a PortsConnected for every connection.
+*/
+void
+encode_snapshot(std::string&    buffer,
+                const Metadata& metadata,
+                const Graph&    graph);
+
+} // namespace patchage
+
+#endif // PATCHAGE_ENCODE_EVENT_HPP
@@ -56,11 +56,29 @@ struct EventPrinter {
     return fmt::format(R"(Add client "{}" ("{}"))", event.id, event.info.label);
   }
 
+  std::string operator()(const event::ClientChanged& event)
+  {
+    return fmt::format(
+      R"(Change client "{}" ("{}"))", event.id, event.info.label);
+  }
+
   std::string operator()(const event::ClientDestroyed& event)
   {
     return fmt::format(R"(Remove client "{}")", event.id);
   }
 
+  std::string operator()(const event::ConnectFailed& event)
+  {
+    return fmt::format(
+      R"(Failed to connect "{}" to "{}")", event.tail, event.head);
+  }
+
+  std::string operator()(const event::DisconnectFailed& event)
+  {
+    return fmt::format(
+      R"(Failed to disconnect "{}" from "{}")", event.tail, event.head);
+  }
+
   std::string operator()(const event::PortCreated& event)
   {
     auto result = fmt::format(R"(Add {}{} {} "{}" ("{}"))",
@@ -77,6 +95,16 @@ struct EventPrinter {
     return result;
   }
 
+  std::string operator()(const event::PortChanged& event)
+  {
+    return fmt::format(R"(Change {}{} {} "{}" ("{}"))",
+                       event.info.type,
+                       event.info.is_terminal ? " terminal" : "",
+                       event.info.direction,
+                       event.id,
+                       event.info.label);
+  }
+
   std::string operator()(const event::PortDestroyed& event)
   {
     return fmt::format(R"(Remove port "{}")", event.id);
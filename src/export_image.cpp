@@ -0,0 +1,76 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "export_image.hpp"
+
+#include "Action.hpp"
+#include "ActionSink.hpp"
+#include "Canvas.hpp"
+#include "Configuration.hpp"
+#include "Event.hpp"
+#include "Graph.hpp"
+#include "Metadata.hpp"
+#include "Setting.hpp"
+#include "handle_event.hpp"
+#include "load_system.hpp"
+
+#include <gtkmm/main.h>
+#include <gtkmm/offscreenwindow.h>
+
+#include <string>
+#include <vector>
+
+namespace patchage {
+namespace {
+
+bool
+has_suffix(const std::string& str, const std::string& suffix)
+{
+  return str.size() > suffix.size() &&
+         !str.compare(str.size() - suffix.size(), suffix.size(), suffix);
+}
+
+} // namespace
+
+bool
+is_image_filename(const std::string& filename)
+{
+  return has_suffix(filename, ".dot") || has_suffix(filename, ".pdf") ||
+         has_suffix(filename, ".ps") || has_suffix(filename, ".svg");
+}
+
+bool
+export_image(const std::string& filename, const Options& options, ILog& log)
+{
+  // Load saved positions, but never save the ones chosen for new modules
+  Configuration conf{[](const Setting&) {}};
+  conf.load();
+
+  std::vector<Event> events;
+  const bool         attached = load_system(options, log, events);
+
+  // Build the canvas in a window that is never shown on screen
+  ActionSink           ignore_actions{[](const Action&) {}};
+  Canvas               canvas{log, ignore_actions, 1600 * 2, 1200 * 2};
+  Gtk::OffscreenWindow window;
+  window.add(canvas.widget());
+  canvas.set_font_size(conf.get<setting::FontSize>());
+
+  Metadata metadata;
+  Graph    graph;
+  for (const auto& event : events) {
+    handle_event(conf, metadata, graph, canvas, log, event);
+  }
+
+  // Let the canvas lay out and size everything before drawing it
+  window.show_all();
+  while (Gtk::Main::events_pending()) {
+    Gtk::Main::iteration(false);
+  }
+
+  canvas.export_image(filename.c_str(), true);
+  window.remove();
+  return attached;
+}
+
+} // namespace patchage
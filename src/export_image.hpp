@@ -0,0 +1,30 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PATCHAGE_EXPORT_IMAGE_HPP
+#define PATCHAGE_EXPORT_IMAGE_HPP
+
+#include <string>
+
+namespace patchage {
+
+class ILog;
+struct Options;
+
+/// Return true if an image can be exported to a file with the given name
+bool
+is_image_filename(const std::string& filename);
+
+/**
+   Attach to the system and export an image of its graph to a file.
+
+   The canvas is built in an offscreen window with modules at their saved
+   positions, so nothing is shown.  The format is chosen by the file
+   extension: .dot, .pdf, .ps, or .svg.
+*/
+bool
+export_image(const std::string& filename, const Options& options, ILog& log);
+
+} // namespace patchage
+
+#endif // PATCHAGE_EXPORT_IMAGE_HPP
@@ -0,0 +1,89 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "graph_cache.hpp"
+
+#include "Event.hpp"
+#include "decode_event.hpp"
+#include "encode_event.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace patchage {
+namespace {
+
+/// Magic string and format version at the start of every cache file
+constexpr char header[] = "PATCHAGE-GRAPH-2\n";
+
+/// Marker at the end of every cache file, so truncation is detected
+constexpr char trailer[] = "PATCHAGE-GRAPH-END\n";
+
+constexpr size_t header_size  = sizeof(header) - 1U;
+constexpr size_t trailer_size = sizeof(trailer) - 1U;
+
+} // namespace
+
+bool
+save_graph_cache(const std::string& path,
+                 const Metadata&    metadata,
+                 const Graph&       graph)
+{
+  std::error_code ec;
+  const auto      dir = std::filesystem::path{path}.parent_path();
+  if (!dir.empty()) {
+    std::filesystem::create_directories(dir, ec);
+  }
+
+  std::string buffer{header, header_size};
+  encode_snapshot(buffer, metadata, graph);
+  buffer.append(trailer, trailer_size);
+
+  // Write a temporary file and rename it so a crash never leaves half a cache
+  const std::string temporary_path = path + ".tmp";
+  std::ofstream     file{temporary_path, std::ios::out | std::ios::binary};
+  if (!file.good()) {
+    return false;
+  }
+
+  file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  file.close();
+  if (file.fail()) {
+    std::remove(temporary_path.c_str());
+    return false;
+  }
+
+  std::filesystem::rename(temporary_path, path, ec);
+  return !ec;
+}
+
+bool
+load_graph_cache(const std::string& path, std::vector<Event>& events)
+{
+  std::ifstream file{path, std::ios::in | std::ios::binary};
+  if (!file.good()) {
+    return false;
+  }
+
+  const std::string buffer{std::istreambuf_iterator<char>{file},
+                           std::istreambuf_iterator<char>{}};
+
+  // A file cut off between frames still decodes, so check the trailer
+  if (buffer.size() < header_size + trailer_size ||
+      buffer.compare(0U, header_size, header) ||
+      buffer.compare(buffer.size() - trailer_size, trailer_size, trailer)) {
+    return false;
+  }
+
+  return decode_events(buffer.data() + header_size,
+                       buffer.size() - header_size - trailer_size,
+                       events);
+}
+
+} // namespace patchage
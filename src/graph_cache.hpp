@@ -0,0 +1,35 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PATCHAGE_GRAPH_CACHE_HPP
+#define PATCHAGE_GRAPH_CACHE_HPP
+
+#include "Event.hpp"
+
+#include <string>
+#include <vector>
+
+namespace patchage {
+
+class Graph;
+class Metadata;
+
+/**
+   Write the graph to a cache file so it can be shown at the next startup.
+
+   The file is a short header, frames as written by encode_snapshot(), and an
+   end marker so that a truncated file is never read as a partial graph.  It
+   is replaced atomically.
+*/
+bool
+save_graph_cache(const std::string& path,
+                 const Metadata&    metadata,
+                 const Graph&       graph);
+
+/// Append the events in a cache file, return false if it can't be read
+bool
+load_graph_cache(const std::string& path, std::vector<Event>& events);
+
+} // namespace patchage
+
+#endif // PATCHAGE_GRAPH_CACHE_HPP
@@ -3,34 +3,52 @@
 
 #include "handle_event.hpp"
 
+#include "Action.hpp"
+#include "ActionSink.hpp"
 #include "Canvas.hpp"
 #include "CanvasPort.hpp"
 #include "ClientType.hpp"
 #include "Configuration.hpp"
+#include "Connection.hpp"
 #include "Event.hpp"
 #include "ILog.hpp"
 #include "Metadata.hpp"
 #include "PortID.hpp"
 #include "Setting.hpp"
+#include "update_model.hpp"
 #include "warnings.hpp"
 
 PATCHAGE_DISABLE_FMT_WARNINGS
 #include <fmt/core.h>
 PATCHAGE_RESTORE_WARNINGS
 
+#include <utility>
 #include <variant>
+#include <vector>
 
 namespace patchage {
 
 namespace {
 
+bool
+is_alsa_port(const CanvasPort* const port)
+{
+  return port->id().type() == PortID::Type::alsa;
+}
+
+bool
+is_jack_port(const CanvasPort* const port)
+{
+  return port->id().type() == PortID::Type::jack;
+}
+
 class EventHandler
 {
 public:
-  explicit EventHandler(Configuration& conf,
-                        Metadata&      metadata,
-                        Canvas&        canvas,
-                        ILog&          log)
+  explicit EventHandler(Configuration&  conf,
+                        const Metadata& metadata,
+                        Canvas&         canvas,
+                        ILog&           log)
     : _conf{conf}
     , _metadata{metadata}
     , _canvas{canvas}
@@ -53,11 +71,14 @@ public:
 
   void operator()(const event::DriverDetached& event)
   {
+    // The model has dropped the driver's ports, so remove their views too
     switch (event.type) {
     case ClientType::alsa:
+      _canvas.remove_ports(is_alsa_port);
       _conf.set<setting::AlsaAttached>(false);
       break;
     case ClientType::jack:
+      _canvas.remove_ports(is_jack_port);
       _conf.set<setting::JackAttached>(false);
       break;
     }
@@ -65,20 +86,33 @@ public:
 
   void operator()(const event::ClientCreated& event)
   {
-    // Don't create empty modules, they will be created when ports are added
-    _metadata.set_client(event.id, event.info);
+    // Don't create empty modules, they will be created when ports are added,
+    // but update any that are shown from the cache
+    _canvas.set_client_name(event.id, event.info.label);
+  }
+
+  void operator()(const event::ClientChanged& event)
+  {
+    _canvas.set_client_name(event.id, event.info.label);
   }
 
   void operator()(const event::ClientDestroyed& event)
   {
     _canvas.remove_module(event.id);
-    _metadata.erase_client(event.id);
   }
 
-  void operator()(const event::PortCreated& event)
+  void operator()(const event::ConnectFailed& event)
+  {
+    _canvas.reject_change(Connection{event.tail, event.head}, true);
+  }
+
+  void operator()(const event::DisconnectFailed& event)
   {
-    _metadata.set_port(event.id, event.info);
+    _canvas.reject_change(Connection{event.tail, event.head}, false);
+  }
 
+  void operator()(const event::PortCreated& event)
+  {
     const auto* const port =
       _canvas.create_port(_conf, _metadata, event.id, event.info);
 
@@ -88,10 +122,20 @@ public:
     }
   }
 
+  void operator()(const event::PortChanged& event)
+  {
+    const auto* const port =
+      _canvas.update_port(_conf, _metadata, event.id, event.info);
+
+    if (!port) {
+      _log.error(
+        fmt::format("Unable to update view for port \"{}\"", event.id));
+    }
+  }
+
   void operator()(const event::PortDestroyed& event)
   {
     _canvas.remove_port(event.id);
-    _metadata.erase_port(event.id);
   }
 
   void operator()(const event::PortsConnected& event)
@@ -122,15 +166,15 @@ public:
       _log.error(
         fmt::format("Unable to find port \"{}\" to disconnect", event.head));
     } else {
-      _canvas.remove_edge_between(port_1, port_2);
+      _canvas.remove_connection(port_1, port_2);
     }
   }
 
 private:
-  Configuration& _conf;
-  Metadata&      _metadata;
-  Canvas&        _canvas;
-  ILog&          _log;
+  Configuration&  _conf;
+  const Metadata& _metadata;
+  Canvas&         _canvas;
+  ILog&           _log;
 };
 
 } // namespace
@@ -138,12 +182,43 @@ private:
 void
 handle_event(Configuration& conf,
              Metadata&      metadata,
+             Graph&         graph,
              Canvas&        canvas,
              ILog&          log,
              const Event&   event)
 {
   EventHandler handler{conf, metadata, canvas, log};
+  update_model(metadata, graph, event);
   std::visit(handler, event);
 }
 
+void
+handle_events(Configuration&            conf,
+              Metadata&                 metadata,
+              Graph&                    graph,
+              Canvas&                   canvas,
+              ILog&                     log,
+              const ActionSink&         action_sink,
+              const std::vector<Event>& events)
+{
+  EventHandler        handler{conf, metadata, canvas, log};
+  std::vector<PortID> new_ports;
+  for (const auto& event : events) {
+    if (const auto id = new_port(metadata, event)) {
+      new_ports.push_back(*id);
+    }
+
+    update_model(metadata, graph, event);
+    std::visit(handler, event);
+  }
+
+  // Make all the connections for rules with a single request to each driver
+  auto connections =
+    rule_connections(conf.connect_rules(), metadata, graph, new_ports);
+
+  if (!connections.empty()) {
+    action_sink(action::ConnectMany{std::move(connections)});
+  }
+}
+
 } // namespace patchage
@@ -4,23 +4,48 @@
 #ifndef PATCHAGE_HANDLE_EVENT_HPP
 #define PATCHAGE_HANDLE_EVENT_HPP
 
+#include "ActionSink.hpp"
 #include "Event.hpp"
 
+#include <vector>
+
 namespace patchage {
 
 class Configuration;
 class Metadata;
+class Graph;
 class Canvas;
 class ILog;
 
-/// Handle an event from the system by updating the GUI as necessary
+/**
+   Handle an event from the system by updating the GUI as necessary.
+
+   The metadata and graph are updated with update_model() before the canvas,
+   so when a driver is detached its ports are removed from both.
+*/
 void
 handle_event(Configuration& conf,
              Metadata&      metadata,
+             Graph&         graph,
              Canvas&        canvas,
              ILog&          log,
              const Event&   event);
 
+/**
+   Handle a batch of events from the system.
+
+   After all events are handled, any connection rules that match new ports
+   are applied by sending actions to `action_sink`.
+*/
+void
+handle_events(Configuration&            conf,
+              Metadata&                 metadata,
+              Graph&                    graph,
+              Canvas&                   canvas,
+              ILog&                     log,
+              const ActionSink&         action_sink,
+              const std::vector<Event>& events);
+
 } // namespace patchage
 
 #endif // PATCHAGE_HANDLE_EVENT_HPP
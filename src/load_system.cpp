@@ -0,0 +1,61 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "load_system.hpp"
+
+#include "ClientType.hpp"
+#include "Driver.hpp"
+#include "Drivers.hpp"
+#include "Event.hpp"
+#include "Options.hpp"
+
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+namespace patchage {
+
+bool
+load_system(const Options& options, ILog& log, std::vector<Event>& events)
+{
+  std::mutex     events_mutex;
+  Driver::Events emitted;
+  Drivers        drivers{log, [&](Driver::Events&& new_events) {
+                    const std::lock_guard<std::mutex> lock{events_mutex};
+                    emitted.insert(emitted.end(),
+                                   std::make_move_iterator(new_events.begin()),
+                                   std::make_move_iterator(new_events.end()));
+                  }};
+
+  std::vector<ClientType> types;
+  if (options.jack_driver_autoattach && drivers.driver(ClientType::jack)) {
+    types.push_back(ClientType::jack);
+  }
+
+  if (options.alsa_driver_autoattach && drivers.driver(ClientType::alsa)) {
+    types.push_back(ClientType::alsa);
+  }
+
+  drivers.attach(types, false);
+
+  bool attached = true;
+  for (const auto type : types) {
+    attached = attached && drivers.driver(type)->is_attached();
+  }
+
+  // Skip anything emitted while attaching, since a refresh replaces it
+  {
+    const std::lock_guard<std::mutex> lock{events_mutex};
+    emitted.clear();
+  }
+
+  drivers.refresh(types, [&events](Driver::Events&& loaded) {
+    events.insert(events.end(),
+                  std::make_move_iterator(loaded.begin()),
+                  std::make_move_iterator(loaded.end()));
+  });
+
+  return attached;
+}
+
+} // namespace patchage
@@ -0,0 +1,28 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PATCHAGE_LOAD_SYSTEM_HPP
+#define PATCHAGE_LOAD_SYSTEM_HPP
+
+#include "Event.hpp"
+
+#include <vector>
+
+namespace patchage {
+
+class ILog;
+struct Options;
+
+/**
+   Attach to the system once and get events that describe it.
+
+   The enabled drivers are attached, refreshed, and detached again, and all
+   of the events they emitted are appended to `events`, starting with a
+   Cleared event.  Returns false if an enabled driver failed to attach.
+*/
+bool
+load_system(const Options& options, ILog& log, std::vector<Event>& events);
+
+} // namespace patchage
+
+#endif // PATCHAGE_LOAD_SYSTEM_HPP
@@ -14,11 +14,15 @@
 
 #include "Options.hpp"
 #include "Patchage.hpp"
+#include "StreamLog.hpp"
+#include "dump_graph.hpp"
+#include "export_image.hpp"
 #include "patchage_config.h"
 
 #include <glibmm/exception.h>
 #include <glibmm/thread.h>
 #include <glibmm/ustring.h>
+#include <gtk/gtk.h>
 #include <gtkmm/main.h>
 
 #if USE_GETTEXT
@@ -30,6 +34,8 @@
 #include <cstring>
 #include <exception>
 #include <iostream>
+#include <optional>
+#include <string>
 
 namespace {
 
@@ -75,9 +81,12 @@ print_usage()
   std::cout << "Usage: patchage [OPTION]...\n";
   std::cout << "Visually connect JACK and ALSA Audio and MIDI ports.\n\n";
   std::cout << "Options:\n";
-  std::cout << "  -h, --help     Display this help and exit\n";
-  std::cout << "  -A, --no-alsa  Do not automatically attach to ALSA\n";
-  std::cout << "  -J, --no-jack  Do not automatically attack to JACK\n";
+  std::cout << "  -h, --help           Display this help and exit\n";
+  std::cout << "  -A, --no-alsa        Do not automatically attach to ALSA\n";
+  std::cout << "  -J, --no-jack        Do not automatically attack to JACK\n";
+  std::cout << "  --dump [FORMAT]      Print the graph as json, dot, or tsv\n";
+  std::cout << "  --export FILE        Export an image to FILE and exit\n";
+  std::cout << "  --profile-startup    Print the time of each startup phase\n";
 }
 
 void
@@ -113,33 +122,80 @@ main(int argc, char** argv)
   try {
     Glib::thread_init();
 
-    const Gtk::Main app(argc, argv);
-    ++argv;
-    --argc;
+    // Remove GTK options without opening a display, which --dump doesn't need
+    gtk_parse_args(&argc, &argv);
 
     // Parse command line options
-    patchage::Options options;
-    while (argc > 0) {
-      if (!strcmp(*argv, "-h") || !strcmp(*argv, "--help")) {
+    patchage::Options                   options;
+    std::optional<patchage::DumpFormat> dump_format;
+    std::optional<std::string>          export_filename;
+    char**                              args   = argv + 1;
+    int                                 n_args = argc - 1;
+    while (n_args > 0) {
+      if (!strcmp(*args, "-h") || !strcmp(*args, "--help")) {
         print_usage();
         return 0;
       }
 
-      if (!strcmp(*argv, "-A") || !strcmp(*argv, "--no-alsa")) {
+      if (!strcmp(*args, "-A") || !strcmp(*args, "--no-alsa")) {
         options.alsa_driver_autoattach = false;
-      } else if (!strcmp(*argv, "-J") || !strcmp(*argv, "--no-jack")) {
+      } else if (!strcmp(*args, "-J") || !strcmp(*args, "--no-jack")) {
         options.jack_driver_autoattach = false;
-      } else if (!strcmp(*argv, "-V") || !strcmp(*argv, "--version")) {
+      } else if (!strcmp(*args, "-V") || !strcmp(*args, "--version")) {
         print_version();
         return 0;
+      } else if (!strcmp(*args, "--dump")) {
+        dump_format = patchage::DumpFormat::json;
+        if (n_args > 1) {
+          if (const auto format = patchage::parse_dump_format(args[1])) {
+            dump_format = format;
+            ++args;
+            --n_args;
+          }
+        }
+      } else if (!strcmp(*args, "--export")) {
+        if (n_args == 1) {
+          std::cerr << "patchage: option requires an argument -- '" << *args
+                    << "'\n";
+          return 1;
+        }
+
+        ++args;
+        --n_args;
+        if (!patchage::is_image_filename(*args)) {
+          std::cerr << "patchage: unknown image format -- '" << *args
+                    << "'\n";
+          return 1;
+        }
+
+        export_filename = *args;
+      } else if (!strcmp(*args, "--profile-startup")) {
+        options.profile_startup = true;
       } else {
-        std::cerr << "patchage: invalid option -- '" << *argv << "'\n";
+        std::cerr << "patchage: invalid option -- '" << *args << "'\n";
         print_usage();
         return 1;
       }
 
-      ++argv;
-      --argc;
+      ++args;
+      --n_args;
+    }
+
+    // Print the graph and exit without a window
+    if (dump_format) {
+      std::ios::sync_with_stdio(false);
+
+      patchage::StreamLog log{"patchage"};
+      return patchage::dump_graph(std::cout, *dump_format, options, log) ? 0
+                                                                         : 1;
+    }
+
+    const Gtk::Main app(argc, argv);
+
+    // Draw the graph offscreen, export it, and exit without a window
+    if (export_filename) {
+      patchage::StreamLog log{"patchage"};
+      return patchage::export_image(*export_filename, options, log) ? 0 : 1;
     }
 
     // Run until main loop is finished
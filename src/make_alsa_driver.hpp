@@ -13,7 +13,7 @@ namespace patchage {
 class ILog;
 
 std::unique_ptr<Driver>
-make_alsa_driver(ILog& log, Driver::EventSink emit_event);
+make_alsa_driver(ILog& log, Driver::EventSink emit_events);
 
 } // namespace patchage
 
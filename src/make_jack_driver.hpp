@@ -14,7 +14,7 @@ class AudioDriver;
 class ILog;
 
 std::unique_ptr<AudioDriver>
-make_jack_driver(ILog& log, Driver::EventSink emit_event);
+make_jack_driver(ILog& log, Driver::EventSink emit_events);
 
 } // namespace patchage
 
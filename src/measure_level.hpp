@@ -0,0 +1,74 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PATCHAGE_MEASURE_LEVEL_HPP
+#define PATCHAGE_MEASURE_LEVEL_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+namespace patchage {
+
+/// The level of a block of audio samples
+struct BlockLevel {
+  float peak;        ///< Maximum absolute sample value
+  float sum_squares; ///< Sum of the squares of all sample values
+};
+
+/**
+   Measure the peak and power of a block of audio samples.
+
+   This is called in the audio thread for every monitored port, so the main
+   loop is written with generic vectors which the compiler lowers to whatever
+   SIMD instructions the target supports (SSE, AVX, NEON, and so on).  The
+   samples need not be aligned, any remainder is handled by a scalar loop.
+   See bench_measure_level for timings.
+*/
+inline BlockLevel
+measure_level(const float* const samples, const size_t n_samples)
+{
+  float  peak        = 0.0f;
+  float  sum_squares = 0.0f;
+  size_t i           = 0U;
+
+#if defined(__GNUC__)
+  // Vectors wider than the target registers are split very poorly
+#  if defined(__AVX__)
+  using Vector = float __attribute__((vector_size(32)));
+#  else
+  using Vector = float __attribute__((vector_size(16)));
+#  endif
+
+  constexpr size_t width = sizeof(Vector) / sizeof(float);
+
+  Vector vector_peak        = {};
+  Vector vector_sum_squares = {};
+  for (; i + width <= n_samples; i += width) {
+    Vector v;
+    memcpy(&v, samples + i, sizeof(v));
+
+    const Vector magnitude = v < 0.0f ? -v : v;
+
+    vector_peak = magnitude > vector_peak ? magnitude : vector_peak;
+    vector_sum_squares += v * v;
+  }
+
+  for (size_t j = 0U; j < width; ++j) {
+    peak = std::max(peak, vector_peak[j]);
+    sum_squares += vector_sum_squares[j];
+  }
+#endif
+
+  for (; i < n_samples; ++i) {
+    peak = std::max(peak, std::fabs(samples[i]));
+    sum_squares += samples[i] * samples[i];
+  }
+
+  return {peak, sum_squares};
+}
+
+} // namespace patchage
+
+#endif // PATCHAGE_MEASURE_LEVEL_HPP
@@ -0,0 +1,133 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "update_model.hpp"
+
+#include "ConnectRules.hpp"
+#include "Connection.hpp"
+#include "Event.hpp"
+#include "Graph.hpp"
+#include "Metadata.hpp"
+#include "PortID.hpp"
+
+#include <optional>
+#include <set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace patchage {
+
+namespace {
+
+class ModelUpdater
+{
+public:
+  explicit ModelUpdater(Metadata& metadata, Graph& graph)
+    : _metadata{metadata}
+    , _graph{graph}
+  {}
+
+  void operator()(const event::Cleared&) { _graph.clear(); }
+
+  void operator()(const event::ClientChanged& event)
+  {
+    _metadata.set_client(event.id, event.info);
+  }
+
+  void operator()(const event::ClientCreated& event)
+  {
+    _metadata.set_client(event.id, event.info);
+  }
+
+  void operator()(const event::ClientDestroyed& event)
+  {
+    _graph.remove_client(event.id);
+    _metadata.erase_client(event.id);
+  }
+
+  void operator()(const event::ConnectFailed&) {}
+
+  void operator()(const event::DisconnectFailed&) {}
+
+  void operator()(const event::DriverAttached&) {}
+
+  void operator()(const event::DriverDetached& event)
+  {
+    _graph.remove_ports(event.type);
+    _metadata.erase_clients(event.type);
+  }
+
+  void operator()(const event::PortChanged& event)
+  {
+    _metadata.set_port(event.id, event.info);
+  }
+
+  void operator()(const event::PortCreated& event)
+  {
+    _metadata.set_port(event.id, event.info);
+    _graph.add_port(event.id);
+  }
+
+  void operator()(const event::PortDestroyed& event)
+  {
+    _graph.remove_port(event.id);
+    _metadata.erase_port(event.id);
+  }
+
+  void operator()(const event::PortsConnected& event)
+  {
+    _graph.connect(event.tail, event.head);
+  }
+
+  void operator()(const event::PortsDisconnected& event)
+  {
+    _graph.disconnect(event.tail, event.head);
+  }
+
+private:
+  Metadata& _metadata;
+  Graph&    _graph;
+};
+
+} // namespace
+
+void
+update_model(Metadata& metadata, Graph& graph, const Event& event)
+{
+  ModelUpdater updater{metadata, graph};
+  std::visit(updater, event);
+}
+
+std::optional<PortID>
+new_port(const Metadata& metadata, const Event& event)
+{
+  if (const auto* const created = std::get_if<event::PortCreated>(&event)) {
+    if (!metadata.port(created->id)) {
+      return created->id;
+    }
+  }
+
+  return {};
+}
+
+std::vector<Connection>
+rule_connections(const ConnectRules&        rules,
+                 const Metadata&            metadata,
+                 const Graph&               graph,
+                 const std::vector<PortID>& ports)
+{
+  // Apply rules once the whole batch, with connections, is in the model
+  std::set<Connection> connections;
+  for (const auto& id : ports) {
+    for (auto& c : rules.connections(metadata, id)) {
+      if (!graph.connected(c.tail, c.head)) {
+        connections.insert(std::move(c));
+      }
+    }
+  }
+
+  return {connections.begin(), connections.end()};
+}
+
+} // namespace patchage
@@ -0,0 +1,43 @@
+// Copyright 2026 David Robillard <d@drobilla.net>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PATCHAGE_UPDATE_MODEL_HPP
+#define PATCHAGE_UPDATE_MODEL_HPP
+
+#include "Connection.hpp"
+#include "Event.hpp"
+#include "PortID.hpp"
+
+#include <optional>
+#include <vector>
+
+namespace patchage {
+
+class ConnectRules;
+class Graph;
+class Metadata;
+
+/// Update the model of the system, without any user interface, for an event
+void
+update_model(Metadata& metadata, Graph& graph, const Event& event);
+
+/**
+   Return the port that an event adds to the model, if any.
+
+   This must be called before the model is updated for the event.  Drivers
+   announce every port again when they are refreshed, so ports that are
+   already known aren't new.
+*/
+std::optional<PortID>
+new_port(const Metadata& metadata, const Event& event);
+
+/// Return the connections that rules make for some new ports
+std::vector<Connection>
+rule_connections(const ConnectRules&        rules,
+                 const Metadata&            metadata,
+                 const Graph&               graph,
+                 const std::vector<PortID>& ports);
+
+} // namespace patchage
+
+#endif // PATCHAGE_UPDATE_MODEL_HPP